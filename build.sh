@@ -6,14 +6,80 @@
 # ./build execute           -   for release and execute it.
 # ./build debug             -   for compile debug.
 # ./build debug execute     -   for debug and execute it.
+# ./build bench             -   for compile the benchmarks.
+# ./build bench execute     -   for benchmarks and execute them.
+# ./build test              -   for compile the tests.
+# ./build test execute      -   for tests and execute them (fails if one fails).
+# ./build profile           -   for release with the Pixmap counters (-DPIXMAP_PROFILE).
+# ./build profile execute   -   for profile and execute it (writes pixmap_profile.json and pixmap_trace.json).
 
 #                                                           #
 
-if [[ $1 == "debug" ]]; then
+PIXMAP_SRC="src/Pixmap/Pixmap.cpp src/Pixmap/PixmapView.cpp src/Pixmap/Blend.cpp src/Pixmap/Composite.cpp src/Pixmap/ThreadPool.cpp src/Pixmap/PixelPool.cpp src/Pixmap/Gradient.cpp src/Pixmap/Fill.cpp src/Pixmap/Gray.cpp src/Pixmap/Filter.cpp src/Pixmap/BlurCache.cpp src/Pixmap/TiledPixmap.cpp src/Pixmap/ImageIO.cpp src/Pixmap/Pipeline.cpp src/Pixmap/DrawList.cpp src/Pixmap/Profile.cpp src/Pixmap/Warp.cpp src/Pixmap/StreamingTexture.cpp"
+
+if [[ $1 == "bench" ]]; then
+
+    printf "Compilation en cours des BENCHMARKS ..."
+
+    g++ -W -Wall -Werror -Wextra -O3 $PIXMAP_SRC src/bench/bench_threads.cpp -o bin/bench_threads -lSDL2 -pthread
+    g++ -W -Wall -Werror -Wextra -O3 $PIXMAP_SRC src/Scene/Scene.cpp src/bench/bench_wave.cpp -o bin/bench_wave -lSDL2 -pthread
+    g++ -W -Wall -Werror -Wextra -O3 $PIXMAP_SRC src/bench/bench_tiled.cpp -o bin/bench_tiled -lSDL2 -pthread
+
+    if [[ $2 == "execute" ]]; then
+
+        printf "\nExecution des BENCHMARKS.\n\n"
+
+        ./bin/bench_threads
+        ./bin/bench_wave
+        ./bin/bench_tiled
+
+    else
+
+        printf "\nLa compilation est fini. DIR: bin/bench_threads bin/bench_wave bin/bench_tiled\n"
+
+    fi
+
+elif [[ $1 == "test" ]]; then
+
+    printf "Compilation en cours des TESTS ..."
+
+    g++ -W -Wall -Werror -Wextra -O2 $PIXMAP_SRC src/tests/test_pixmap_view.cpp -o bin/test_pixmap_view -lSDL2 -pthread || exit 1
+
+    if [[ $2 == "execute" ]]; then
+
+        printf "\nExecution des TESTS.\n\n"
+
+        ./bin/test_pixmap_view || exit 1
+
+    else
+
+        printf "\nLa compilation est fini. DIR: bin/test_pixmap_view\n"
+
+    fi
+
+elif [[ $1 == "profile" ]]; then
+
+    printf "Compilation en cours de la version PROFILE ..."
+
+    g++ -DPIXMAP_PROFILE -W -Wall -Werror -Wextra -O3 $PIXMAP_SRC src/Scene/Scene.cpp src/Scene/FrameScheduler.cpp src/TextRenderer/TextRenderer.cpp src/main.cpp -o bin/main_profile -lSDL2 -lSDL2_ttf -pthread
+
+    if [[ $2 == "execute" ]]; then
+
+        printf "\nExecution de la version PROFILE.\n\n"
+
+        ./bin/main_profile
+
+    else
+
+        printf "\nLa compilation est fini. DIR: bin/main_profile\n"
+
+    fi
+
+elif [[ $1 == "debug" ]]; then
 
     printf "Compilation en cours de la version DEBUG ..."
 
-    g++ -g -DDEBUG -W -Wall -Werror -Wextra -O3 src/Pixmap/Pixmap.cpp src/main.cpp -o bin/main_debug -lSDL2 -lSDL2_ttf
+    g++ -g -DDEBUG -W -Wall -Werror -Wextra -O3 $PIXMAP_SRC src/Scene/Scene.cpp src/Scene/FrameScheduler.cpp src/TextRenderer/TextRenderer.cpp src/main.cpp -o bin/main_debug -lSDL2 -lSDL2_ttf -pthread
 
     if [[ $2 == "execute" ]]; then
 
@@ -31,7 +97,7 @@ else
 
     printf "Compilation en cours de la version RELEASE ..."
 
-    g++ -W -Wall -Werror -Wextra -O3 src/Pixmap/Pixmap.cpp src/main.cpp -o bin/main_release -lSDL2 -lSDL2_ttf
+    g++ -W -Wall -Werror -Wextra -O3 $PIXMAP_SRC src/Scene/Scene.cpp src/Scene/FrameScheduler.cpp src/TextRenderer/TextRenderer.cpp src/main.cpp -o bin/main_release -lSDL2 -lSDL2_ttf -pthread
 
     if [[ $1 == "execute" ]]; then
 
@@ -0,0 +1,502 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <algorithm>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "Blend.hpp"
+
+#if defined (__x86_64__) || defined (__i386__)
+  #include <immintrin.h>
+  #define PIXMAP_X86
+#endif
+
+typedef void (*blend_span_fn)       (pixel const* const src, pixel* const dst, int const n);
+typedef void (*blend_span_solid_fn) (pixel const color, pixel* const dst, int const n);
+typedef void (*convert_span_fn)     (pixel const* const src, pixel* const dst, int const n);
+
+/* SCALAR */
+
+static void blend_span_scalar (pixel const* const src, pixel* const dst, int const n)
+{
+    for (int i = 0; i < n; i++)
+        pixel_put_alpha (src[i], dst + i);
+}
+
+static void blend_span_solid_scalar (pixel const color, pixel* const dst, int const n)
+{
+    for (int i = 0; i < n; i++)
+        pixel_put_alpha (color, dst + i);
+}
+
+static void blend_span_premultiplied_scalar (pixel const* const src, pixel* const dst, int const n)
+{
+    for (int i = 0; i < n; i++)
+        pixel_put_alpha_premultiplied (src[i], dst + i);
+}
+
+static void blend_span_solid_premultiplied_scalar (pixel const color, pixel* const dst, int const n)
+{
+    for (int i = 0; i < n; i++)
+        pixel_put_alpha_premultiplied (color, dst + i);
+}
+
+static void premultiply_span_scalar (pixel const* const src, pixel* const dst, int const n)
+{
+    for (int i = 0; i < n; i++)
+        dst[i] = pixel_premultiply (src[i]);
+}
+
+#ifdef PIXMAP_X86
+
+/* SSE2 */
+
+// 's' and 'd' hold two pixels each, one component per 16-bit lane.
+// t = s*a + d*(255-a) + 128 never exceeds 16 bits, then (t + (t >> 8)) >> 8 is the rounded /255.
+
+__attribute__ ((target ("sse2")))
+static inline __m128i blend_x2_sse2 (__m128i const s, __m128i const d)
+{
+    __m128i const a  = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m128i const ia = _mm_sub_epi16 (_mm_set1_epi16 (255), a);
+    __m128i t = _mm_add_epi16 (_mm_mullo_epi16 (s, a), _mm_mullo_epi16 (d, ia));
+    t = _mm_add_epi16 (t, _mm_set1_epi16 (128));
+    return _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+}
+
+__attribute__ ((target ("sse2")))
+static void blend_span_sse2 (pixel const* const src, pixel* const dst, int const n)
+{
+    __m128i const zero = _mm_setzero_si128();
+
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const s = _mm_loadu_si128 ((__m128i const*) (src + i));
+        __m128i const d = _mm_loadu_si128 ((__m128i const*) (dst + i));
+
+        __m128i const lo = blend_x2_sse2 (_mm_unpacklo_epi8 (s, zero), _mm_unpacklo_epi8 (d, zero));
+        __m128i const hi = blend_x2_sse2 (_mm_unpackhi_epi8 (s, zero), _mm_unpackhi_epi8 (d, zero));
+
+        _mm_storeu_si128 ((__m128i*) (dst + i), _mm_packus_epi16 (lo, hi));
+    }
+
+    blend_span_scalar (src + i, dst + i, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void blend_span_solid_sse2 (pixel const color, pixel* const dst, int const n)
+{
+    __m128i const zero = _mm_setzero_si128();
+
+    // The source side of the blend is the same for every pixel: s*a + 128 is computed once
+    __m128i const s  = _mm_unpacklo_epi8 (_mm_set1_epi32 ((int) color), zero);
+    __m128i const a  = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m128i const ia = _mm_sub_epi16 (_mm_set1_epi16 (255), a);
+    __m128i const sa = _mm_add_epi16 (_mm_mullo_epi16 (s, a), _mm_set1_epi16 (128));
+
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const d = _mm_loadu_si128 ((__m128i const*) (dst + i));
+
+        __m128i lo = _mm_add_epi16 (sa, _mm_mullo_epi16 (_mm_unpacklo_epi8 (d, zero), ia));
+        __m128i hi = _mm_add_epi16 (sa, _mm_mullo_epi16 (_mm_unpackhi_epi8 (d, zero), ia));
+
+        lo = _mm_srli_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), 8);
+        hi = _mm_srli_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), 8);
+
+        _mm_storeu_si128 ((__m128i*) (dst + i), _mm_packus_epi16 (lo, hi));
+    }
+
+    blend_span_solid_scalar (color, dst + i, n - i);
+}
+
+// Premultiplied: d * (255 - a), rounded /255, plus s. Valid premultiplied sources never exceed 255, packus clamps the others
+
+__attribute__ ((target ("sse2")))
+static inline __m128i blend_premultiplied_x2_sse2 (__m128i const s, __m128i const d)
+{
+    __m128i const a  = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m128i const ia = _mm_sub_epi16 (_mm_set1_epi16 (255), a);
+    __m128i t = _mm_add_epi16 (_mm_mullo_epi16 (d, ia), _mm_set1_epi16 (128));
+    t = _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+    return _mm_add_epi16 (t, s);
+}
+
+__attribute__ ((target ("sse2")))
+static void blend_span_premultiplied_sse2 (pixel const* const src, pixel* const dst, int const n)
+{
+    __m128i const zero = _mm_setzero_si128();
+
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const s = _mm_loadu_si128 ((__m128i const*) (src + i));
+        __m128i const d = _mm_loadu_si128 ((__m128i const*) (dst + i));
+
+        __m128i const lo = blend_premultiplied_x2_sse2 (_mm_unpacklo_epi8 (s, zero), _mm_unpacklo_epi8 (d, zero));
+        __m128i const hi = blend_premultiplied_x2_sse2 (_mm_unpackhi_epi8 (s, zero), _mm_unpackhi_epi8 (d, zero));
+
+        _mm_storeu_si128 ((__m128i*) (dst + i), _mm_packus_epi16 (lo, hi));
+    }
+
+    blend_span_premultiplied_scalar (src + i, dst + i, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void blend_span_solid_premultiplied_sse2 (pixel const color, pixel* const dst, int const n)
+{
+    __m128i const zero = _mm_setzero_si128();
+
+    __m128i const s  = _mm_unpacklo_epi8 (_mm_set1_epi32 ((int) color), zero);
+    __m128i const a  = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m128i const ia = _mm_sub_epi16 (_mm_set1_epi16 (255), a);
+    __m128i const r  = _mm_set1_epi16 (128);
+
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const d = _mm_loadu_si128 ((__m128i const*) (dst + i));
+
+        __m128i lo = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (d, zero), ia), r);
+        __m128i hi = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (d, zero), ia), r);
+
+        lo = _mm_add_epi16 (_mm_srli_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), 8), s);
+        hi = _mm_add_epi16 (_mm_srli_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), 8), s);
+
+        _mm_storeu_si128 ((__m128i*) (dst + i), _mm_packus_epi16 (lo, hi));
+    }
+
+    blend_span_solid_premultiplied_scalar (color, dst + i, n - i);
+}
+
+// Multiplier (a, a, a, 255) per pixel, so the alpha lane comes out unchanged from the same rounded /255
+
+__attribute__ ((target ("sse2")))
+static inline __m128i premultiply_x2_sse2 (__m128i const c)
+{
+    __m128i const alpha_lanes = _mm_setr_epi16 (0, 0, 0, -1, 0, 0, 0, -1);
+    __m128i const a = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (c, 0xFF), 0xFF);
+    __m128i const m = _mm_or_si128 (_mm_andnot_si128 (alpha_lanes, a), _mm_and_si128 (alpha_lanes, _mm_set1_epi16 (255)));
+    __m128i const t = _mm_add_epi16 (_mm_mullo_epi16 (c, m), _mm_set1_epi16 (128));
+    return _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+}
+
+__attribute__ ((target ("sse2")))
+static void premultiply_span_sse2 (pixel const* const src, pixel* const dst, int const n)
+{
+    __m128i const zero = _mm_setzero_si128();
+
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const c = _mm_loadu_si128 ((__m128i const*) (src + i));
+        __m128i const lo = premultiply_x2_sse2 (_mm_unpacklo_epi8 (c, zero));
+        __m128i const hi = premultiply_x2_sse2 (_mm_unpackhi_epi8 (c, zero));
+        _mm_storeu_si128 ((__m128i*) (dst + i), _mm_packus_epi16 (lo, hi));
+    }
+
+    premultiply_span_scalar (src + i, dst + i, n - i);
+}
+
+/* AVX2 */
+
+__attribute__ ((target ("avx2")))
+static inline __m256i blend_x4_avx2 (__m256i const s, __m256i const d)
+{
+    __m256i const a  = _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m256i const ia = _mm256_sub_epi16 (_mm256_set1_epi16 (255), a);
+    __m256i t = _mm256_add_epi16 (_mm256_mullo_epi16 (s, a), _mm256_mullo_epi16 (d, ia));
+    t = _mm256_add_epi16 (t, _mm256_set1_epi16 (128));
+    return _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+}
+
+__attribute__ ((target ("avx2")))
+static void blend_span_avx2 (pixel const* const src, pixel* const dst, int const n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+
+    int i = 0;
+
+    // Unpack/pack work inside each 128-bit lane, so the pixel order is preserved
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const s = _mm256_loadu_si256 ((__m256i const*) (src + i));
+        __m256i const d = _mm256_loadu_si256 ((__m256i const*) (dst + i));
+
+        __m256i const lo = blend_x4_avx2 (_mm256_unpacklo_epi8 (s, zero), _mm256_unpacklo_epi8 (d, zero));
+        __m256i const hi = blend_x4_avx2 (_mm256_unpackhi_epi8 (s, zero), _mm256_unpackhi_epi8 (d, zero));
+
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_packus_epi16 (lo, hi));
+    }
+
+    blend_span_sse2 (src + i, dst + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void blend_span_solid_avx2 (pixel const color, pixel* const dst, int const n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+
+    __m256i const s  = _mm256_unpacklo_epi8 (_mm256_set1_epi32 ((int) color), zero);
+    __m256i const a  = _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m256i const ia = _mm256_sub_epi16 (_mm256_set1_epi16 (255), a);
+    __m256i const sa = _mm256_add_epi16 (_mm256_mullo_epi16 (s, a), _mm256_set1_epi16 (128));
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const d = _mm256_loadu_si256 ((__m256i const*) (dst + i));
+
+        __m256i lo = _mm256_add_epi16 (sa, _mm256_mullo_epi16 (_mm256_unpacklo_epi8 (d, zero), ia));
+        __m256i hi = _mm256_add_epi16 (sa, _mm256_mullo_epi16 (_mm256_unpackhi_epi8 (d, zero), ia));
+
+        lo = _mm256_srli_epi16 (_mm256_add_epi16 (lo, _mm256_srli_epi16 (lo, 8)), 8);
+        hi = _mm256_srli_epi16 (_mm256_add_epi16 (hi, _mm256_srli_epi16 (hi, 8)), 8);
+
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_packus_epi16 (lo, hi));
+    }
+
+    blend_span_solid_sse2 (color, dst + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i blend_premultiplied_x4_avx2 (__m256i const s, __m256i const d)
+{
+    __m256i const a  = _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m256i const ia = _mm256_sub_epi16 (_mm256_set1_epi16 (255), a);
+    __m256i t = _mm256_add_epi16 (_mm256_mullo_epi16 (d, ia), _mm256_set1_epi16 (128));
+    t = _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+    return _mm256_add_epi16 (t, s);
+}
+
+__attribute__ ((target ("avx2")))
+static void blend_span_premultiplied_avx2 (pixel const* const src, pixel* const dst, int const n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const s = _mm256_loadu_si256 ((__m256i const*) (src + i));
+        __m256i const d = _mm256_loadu_si256 ((__m256i const*) (dst + i));
+
+        __m256i const lo = blend_premultiplied_x4_avx2 (_mm256_unpacklo_epi8 (s, zero), _mm256_unpacklo_epi8 (d, zero));
+        __m256i const hi = blend_premultiplied_x4_avx2 (_mm256_unpackhi_epi8 (s, zero), _mm256_unpackhi_epi8 (d, zero));
+
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_packus_epi16 (lo, hi));
+    }
+
+    blend_span_premultiplied_sse2 (src + i, dst + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void blend_span_solid_premultiplied_avx2 (pixel const color, pixel* const dst, int const n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+
+    __m256i const s  = _mm256_unpacklo_epi8 (_mm256_set1_epi32 ((int) color), zero);
+    __m256i const a  = _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (s, 0xFF), 0xFF);
+    __m256i const ia = _mm256_sub_epi16 (_mm256_set1_epi16 (255), a);
+    __m256i const r  = _mm256_set1_epi16 (128);
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const d = _mm256_loadu_si256 ((__m256i const*) (dst + i));
+
+        __m256i lo = _mm256_add_epi16 (_mm256_mullo_epi16 (_mm256_unpacklo_epi8 (d, zero), ia), r);
+        __m256i hi = _mm256_add_epi16 (_mm256_mullo_epi16 (_mm256_unpackhi_epi8 (d, zero), ia), r);
+
+        lo = _mm256_add_epi16 (_mm256_srli_epi16 (_mm256_add_epi16 (lo, _mm256_srli_epi16 (lo, 8)), 8), s);
+        hi = _mm256_add_epi16 (_mm256_srli_epi16 (_mm256_add_epi16 (hi, _mm256_srli_epi16 (hi, 8)), 8), s);
+
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_packus_epi16 (lo, hi));
+    }
+
+    blend_span_solid_premultiplied_sse2 (color, dst + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i premultiply_x4_avx2 (__m256i const c)
+{
+    __m256i const alpha_lanes = _mm256_setr_epi16 (0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+    __m256i const a = _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (c, 0xFF), 0xFF);
+    __m256i const m = _mm256_or_si256 (_mm256_andnot_si256 (alpha_lanes, a), _mm256_and_si256 (alpha_lanes, _mm256_set1_epi16 (255)));
+    __m256i const t = _mm256_add_epi16 (_mm256_mullo_epi16 (c, m), _mm256_set1_epi16 (128));
+    return _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+}
+
+__attribute__ ((target ("avx2")))
+static void premultiply_span_avx2 (pixel const* const src, pixel* const dst, int const n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const c = _mm256_loadu_si256 ((__m256i const*) (src + i));
+        __m256i const lo = premultiply_x4_avx2 (_mm256_unpacklo_epi8 (c, zero));
+        __m256i const hi = premultiply_x4_avx2 (_mm256_unpackhi_epi8 (c, zero));
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_packus_epi16 (lo, hi));
+    }
+
+    premultiply_span_sse2 (src + i, dst + i, n - i);
+}
+
+#endif
+
+/* RUNTIME DISPATCH */
+
+static blend_span_fn select_blend_span ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return blend_span_avx2;
+        if (__builtin_cpu_supports ("sse2")) return blend_span_sse2;
+    #endif
+    return blend_span_scalar;
+}
+
+static blend_span_solid_fn select_blend_span_solid ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return blend_span_solid_avx2;
+        if (__builtin_cpu_supports ("sse2")) return blend_span_solid_sse2;
+    #endif
+    return blend_span_solid_scalar;
+}
+
+void blend_span (pixel const* const src, pixel* const dst, int const n)
+{
+    static blend_span_fn const fn = select_blend_span();
+    fn (src, dst, n);
+}
+
+void blend_span_solid (pixel const color, pixel* const dst, int const n)
+{
+    pixel const alpha = color >> 24;
+
+    if (alpha == 0) return; // Fully transparent, nothing changes
+
+    static blend_span_solid_fn const fn = select_blend_span_solid();
+    fn (color, dst, n);
+}
+
+static blend_span_fn select_blend_span_premultiplied ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return blend_span_premultiplied_avx2;
+        if (__builtin_cpu_supports ("sse2")) return blend_span_premultiplied_sse2;
+    #endif
+    return blend_span_premultiplied_scalar;
+}
+
+static blend_span_solid_fn select_blend_span_solid_premultiplied ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return blend_span_solid_premultiplied_avx2;
+        if (__builtin_cpu_supports ("sse2")) return blend_span_solid_premultiplied_sse2;
+    #endif
+    return blend_span_solid_premultiplied_scalar;
+}
+
+static convert_span_fn select_premultiply_span ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return premultiply_span_avx2;
+        if (__builtin_cpu_supports ("sse2")) return premultiply_span_sse2;
+    #endif
+    return premultiply_span_scalar;
+}
+
+void blend_span_premultiplied (pixel const* const src, pixel* const dst, int const n)
+{
+    static blend_span_fn const fn = select_blend_span_premultiplied();
+    fn (src, dst, n);
+}
+
+void blend_span_solid_premultiplied (pixel const color, pixel* const dst, int const n)
+{
+    if ((color >> 24) == 0 && (color & 0x00FFFFFF) == 0) return; // Transparent black adds nothing
+
+    static blend_span_solid_fn const fn = select_blend_span_solid_premultiplied();
+    fn (color, dst, n);
+}
+
+void premultiply_span (pixel const* const src, pixel* const dst, int const n)
+{
+    static convert_span_fn const fn = select_premultiply_span();
+    fn (src, dst, n);
+}
+
+void unpremultiply_span (pixel const* const src, pixel* const dst, int const n)
+{
+
+    // 255 / a in 16.16 fixed point: no division per pixel, and this is only used on upload or format change
+    static struct ReciprocalTable
+    {
+        uint32_t values[256];
+        ReciprocalTable () { values[0] = 0; for (int a = 1; a < 256; a++) values[a] = ((255u << 16) + a / 2) / a; }
+    } const reciprocal;
+
+    for (int i = 0; i < n; i++)
+    {
+        pixel const p = src[i];
+        pixel const a = p >> 24;
+
+        if (a == 255) { dst[i] = p; continue; }
+
+        uint32_t const f = reciprocal.values[a];
+        pixel out = a << 24;
+
+        for (int c = 0; c < 24; c += 8)
+            out |= std::min<uint32_t> (255, (((p >> c) & 0xFF) * f + 0x8000) >> 16) << c;
+
+        dst[i] = out;
+    }
+
+}
+
+void blend_span_convert (pixel const* const src, PixelFormat const src_format, pixel* const dst, PixelFormat const dst_format, int const n)
+{
+
+    if (src_format == dst_format)
+    {
+        if (dst_format == PIXEL_PREMULTIPLIED) blend_span_premultiplied (src, dst, n);
+        else                                   blend_span (src, dst, n);
+        return;
+    }
+
+    // Mixed formats: the row is converted to the target format first
+    static thread_local std::vector<pixel> converted;
+    converted.resize (n);
+
+    if (dst_format == PIXEL_PREMULTIPLIED)
+    {
+        premultiply_span (src, converted.data(), n);
+        blend_span_premultiplied (converted.data(), dst, n);
+    }
+    else
+    {
+        unpremultiply_span (src, converted.data(), n);
+        blend_span (converted.data(), dst, n);
+    }
+
+}
@@ -0,0 +1,34 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __BLEND_HPP__
+#define __BLEND_HPP__
+
+#include "Pixmap.hpp"
+
+/* Span compositing ("src over dst"), 4/8 pixels per iteration with SSE2/AVX2 selected at runtime
+   and a scalar fallback. All paths use the exact integer /255 rounding of 'pixel_put_alpha',
+   so results are bit-identical whatever the CPU. */
+
+void blend_span (pixel const* const src, pixel* const dst, int const n);  // Per-pixel source alpha
+void blend_span_solid (pixel const color, pixel* const dst, int const n); // Same source pixel for the whole span
+
+/* Premultiplied ARGB (PIXEL_PREMULTIPLIED): "over" is dst = src + dst * (255 - a) / 255, one
+   multiply per component, and the alpha channel follows the same formula. */
+
+void blend_span_premultiplied (pixel const* const src, pixel* const dst, int const n);
+void blend_span_solid_premultiplied (pixel const color, pixel* const dst, int const n); // 'color' already premultiplied
+
+void premultiply_span (pixel const* const src, pixel* const dst, int const n);   // c = c * a / 255, rounded (in place allowed)
+void unpremultiply_span (pixel const* const src, pixel* const dst, int const n); // Inverse, rounded, 0 where a = 0 (in place allowed)
+
+void blend_span_convert (pixel const* const src, PixelFormat const src_format, pixel* const dst, PixelFormat const dst_format, int const n); // "over" in the target format
+
+#endif
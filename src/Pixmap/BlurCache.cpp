@@ -0,0 +1,232 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <algorithm>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "BlurCache.hpp"
+#include "Profile.hpp"
+
+BlurCache::BlurCache ()
+{
+    this -> width  = 0;
+    this -> height = 0;
+    this -> radius = 0;
+    this -> valid  = false;
+}
+
+void BlurCache::invalidate ()
+{
+    valid = false;
+}
+
+size_t BlurCache::get_memory () const
+{
+    return col_sums.capacity() * sizeof (int);
+}
+
+bool BlurCache::matches (Pixmap const &source, Pixmap const &target, int const radius) const
+{
+    return valid && source.width == width && source.height == height && radius == this -> radius
+        && target.width == width && target.height == height && target.format == source.format;
+}
+
+/* PASSES */
+
+void BlurCache::update_columns (Pixmap const &source, int const x1, int const x2, int const y_begin, int const y_end)
+{
+
+    // Same sliding window as 'Pixmap::box_blur', limited to columns [x1, x2]: the first row of the
+    // band is summed whole, every next one is the previous row plus the row entering the window
+    // minus the row leaving it
+
+    int const n = x2 - x1 + 1;
+    int const last_y = height - 1;
+
+    int* const first = col_sums.data() + ((size_t) y_begin * width + x1) * 4;
+    std::fill (first, first + n * 4, 0);
+
+    for (int y = std::max (y_begin - radius, 0); y <= std::min (y_begin + radius, last_y); y++)
+    {
+        pixel const* s_ptr = source.datas + y * source.stride + x1;
+        int* c_ptr = first;
+
+        for (int x = 0; x < n; x++, s_ptr++, c_ptr += 4)
+        {
+            pixcmp r,g,b,a;
+            pixel_get_rgba (*s_ptr, &r, &g, &b, &a);
+            c_ptr[0] += r; c_ptr[1] += g; c_ptr[2] += b; c_ptr[3] += a;
+        }
+    }
+
+    for (int y = y_begin + 1; y < y_end; y++)
+    {
+
+        int const y_in  = y + radius;
+        int const y_out = y - radius - 1;
+
+        int const* p_ptr = col_sums.data() + ((size_t) (y - 1) * width + x1) * 4;
+        int* c_ptr = col_sums.data() + ((size_t) y * width + x1) * 4;
+
+        std::copy (p_ptr, p_ptr + n * 4, c_ptr);
+
+        if (y_in <= last_y)
+        {
+            pixel const* s_ptr = source.datas + y_in * source.stride + x1;
+
+            for (int x = 0; x < n; x++)
+            {
+                pixcmp r,g,b,a;
+                pixel_get_rgba (s_ptr[x], &r, &g, &b, &a);
+                c_ptr[4 * x] += r; c_ptr[4 * x + 1] += g; c_ptr[4 * x + 2] += b; c_ptr[4 * x + 3] += a;
+            }
+        }
+
+        if (y_out >= 0)
+        {
+            pixel const* s_ptr = source.datas + y_out * source.stride + x1;
+
+            for (int x = 0; x < n; x++)
+            {
+                pixcmp r,g,b,a;
+                pixel_get_rgba (s_ptr[x], &r, &g, &b, &a);
+                c_ptr[4 * x] -= r; c_ptr[4 * x + 1] -= g; c_ptr[4 * x + 2] -= b; c_ptr[4 * x + 3] -= a;
+            }
+        }
+
+    }
+
+}
+
+void BlurCache::blur_rows (Pixmap &target, int const x1, int const x2, int const y_begin, int const y_end) const
+{
+
+    int const last_x = width  - 1;
+    int const last_y = height - 1;
+
+    for (int y = y_begin; y < y_end; y++)
+    {
+
+        int const* const sums = col_sums.data() + (size_t) y * width * 4;
+        int const rows = std::min (y + radius, last_y) - std::max (y - radius, 0) + 1;
+
+        int sum_r = 0, sum_g = 0, sum_b = 0, sum_a = 0;
+
+        for (int x = std::max (x1 - radius, 0); x <= std::min (x1 + radius, last_x); x++)
+        {
+            int const* c_ptr = sums + x * 4;
+            sum_r += c_ptr[0]; sum_g += c_ptr[1]; sum_b += c_ptr[2]; sum_a += c_ptr[3];
+        }
+
+        pixel* d_ptr = target.datas + y * target.stride + x1;
+
+        for (int x = x1; x <= x2; x++, d_ptr++)
+        {
+
+            if (x > x1) // Slide the horizontal window one column right
+            {
+                int const x_in  = x + radius;
+                int const x_out = x - radius - 1;
+
+                if (x_in <= last_x)
+                {
+                    int const* c_ptr = sums + x_in * 4;
+                    sum_r += c_ptr[0]; sum_g += c_ptr[1]; sum_b += c_ptr[2]; sum_a += c_ptr[3];
+                }
+
+                if (x_out >= 0)
+                {
+                    int const* c_ptr = sums + x_out * 4;
+                    sum_r -= c_ptr[0]; sum_g -= c_ptr[1]; sum_b -= c_ptr[2]; sum_a -= c_ptr[3];
+                }
+            }
+
+            int const cols = std::min (x + radius, last_x) - std::max (x - radius, 0) + 1;
+            int const area = rows * cols;
+
+            *d_ptr = make_pixel_rgba ((pixcmp) (sum_r / area), (pixcmp) (sum_g / area),
+                                      (pixcmp) (sum_b / area), (pixcmp) (sum_a / area));
+
+        }
+
+    }
+
+}
+
+/* UPDATE */
+
+Rectbox BlurCache::update (Pixmap const &source, Pixmap &target, float const radius, Rectbox const &dirty)
+{
+
+    if (source.datas == nullptr || source.width <= 0 || source.height <= 0) return Rectbox();
+
+    int const i_radius = std::max ((int) radius, 0);
+    Rectbox changed (dirty);
+
+    if (!matches (source, target, i_radius)) // Everything, the target content is not the blur of the source
+    {
+        target.resize (source.width, source.height, source.with_alpha);
+        target.format = source.format; // Like 'average_filter': premultiplied pixmaps blur in place
+
+        this -> width  = source.width;
+        this -> height = source.height;
+        this -> radius = i_radius;
+        col_sums.resize ((size_t) width * height * 4);
+
+        changed.setter (0, 0, width - 1, height - 1);
+    }
+    else if (!source.clip_rect (&changed))
+    {
+        return Rectbox();
+    }
+
+    // The column sums change within the radius above and below the rect, the output also on its sides
+    int const y1 = std::max (changed.y1 - i_radius, 0);
+    int const y2 = std::min (changed.y2 + i_radius, height - 1);
+
+    Rectbox const out (std::max (changed.x1 - i_radius, 0), y1, std::min (changed.x2 + i_radius, width - 1), y2);
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_AVERAGE_FILTER, (long long) (out.x2 - out.x1 + 1) * (y2 - y1 + 1), (long long) (out.x2 - out.x1 + 1) * (y2 - y1 + 1) * sizeof (pixel));
+
+    // A band needs the sums of its own rows only: both passes run band by band
+    target.for_each_band (y2 - y1 + 1, out.x2 - out.x1 + 1, [&] (int const band_begin, int const band_end)
+    {
+        update_columns (source, changed.x1, changed.x2, y1 + band_begin, y1 + band_end);
+        blur_rows (target, out.x1, out.x2, y1 + band_begin, y1 + band_end);
+    });
+
+    target.add_damage (out);
+    valid = true;
+
+    return out;
+
+}
+
+Rectbox BlurCache::update (Pixmap const &source, Pixmap &target, float const radius, std::vector<Rectbox> const &dirty)
+{
+
+    // Rebuilt once for the whole list
+    if (!matches (source, target, std::max ((int) radius, 0)))
+        return update (source, target, radius, Rectbox (0, 0, source.width - 1, source.height - 1));
+
+    Rectbox area;
+
+    for (Rectbox const &rect : dirty)
+    {
+        Rectbox const out = update (source, target, radius, rect);
+        if (out.x1 < 0) continue;
+
+        if (area.x1 < 0) area = out;
+        else area.setter (std::min (area.x1, out.x1), std::min (area.y1, out.y1), std::max (area.x2, out.x2), std::max (area.y2, out.y2));
+    }
+
+    return area;
+
+}
@@ -0,0 +1,54 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __BLURCACHE_HPP__
+#define __BLURCACHE_HPP__
+
+#include <vector>
+#include "Pixmap.hpp"
+
+/* Incremental 'average_filter' of a layer that changes a little every frame. The cache keeps the
+   vertical pass of the box filter, the sum of the (2r+1) rows around each pixel per channel, for
+   the whole image. When a rect of the source changes, only the sums of its columns within the
+   radius are recomputed, then only the target pixels within the radius of the rect: the cost is
+   proportional to the changed area, not to the image. The result is exactly 'average_filter'.
+   The source is left unblurred (the target is another Pixmap), and nothing else may write into
+   the target in between, or 'invalidate' must be called. */
+
+class BlurCache {
+
+  private:
+    int width;
+    int height;
+    int radius;
+    std::vector<int> col_sums; // 4 per pixel (r, g, b, a), rows * width, the window clamped to the image
+    bool valid;
+
+    bool matches (Pixmap const &source, Pixmap const &target, int const radius) const; // False: everything has to be recomputed
+
+    void update_columns (Pixmap const &source, int const x1, int const x2, int const y_begin, int const y_end); // Sums of columns [x1, x2], rows [y_begin, y_end)
+    void blur_rows (Pixmap &target, int const x1, int const x2, int const y_begin, int const y_end) const;      // Horizontal pass over the same kind of range
+
+  public:
+    BlurCache ();
+
+    void invalidate (); // The next update recomputes everything
+
+    // 'target' receives the blur of 'source' (resized to it). Everything is recomputed on the first
+    // call, or when the size or radius changed. Returns the area of 'target' that was rewritten,
+    // Rectbox() (all -1) when nothing was
+    Rectbox update (Pixmap const &source, Pixmap &target, float const radius, Rectbox const &dirty);
+    Rectbox update (Pixmap const &source, Pixmap &target, float const radius, std::vector<Rectbox> const &dirty); // E.g. 'source.get_damage ()'
+
+    size_t get_memory () const; // Bytes held by the sums
+
+};
+
+#endif
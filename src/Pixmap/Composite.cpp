@@ -0,0 +1,84 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <vector>
+#include <SDL2/SDL.h>
+#include "Composite.hpp"
+
+typedef void (*composite_span_fn)  (pixel const* const src, void* const dst, int const n);
+typedef void (*composite_solid_fn) (pixel const color, void* const dst, int const n);
+
+/* Every (storage, blend) pair, in the order of SpanFormat and BlendMode */
+
+template <class Storage>
+struct CompositeRow {
+    static constexpr composite_span_fn spans[BLEND_MODE_COUNT] = {
+        CompositeKernel<Storage, BlendCopy>::span, CompositeKernel<Storage, BlendOver>::span,
+        CompositeKernel<Storage, BlendAdd>::span,  CompositeKernel<Storage, BlendMultiply>::span
+    };
+    static constexpr composite_solid_fn solids[BLEND_MODE_COUNT] = {
+        CompositeKernel<Storage, BlendCopy>::solid, CompositeKernel<Storage, BlendOver>::solid,
+        CompositeKernel<Storage, BlendAdd>::solid,  CompositeKernel<Storage, BlendMultiply>::solid
+    };
+};
+
+static composite_span_fn const* const span_kernels[SPAN_FORMAT_COUNT] = {
+    CompositeRow<StorageStraight>::spans, CompositeRow<StoragePremultiplied>::spans,
+    CompositeRow<StorageGray8>::spans,    CompositeRow<StorageRGB565>::spans
+};
+
+static composite_solid_fn const* const solid_kernels[SPAN_FORMAT_COUNT] = {
+    CompositeRow<StorageStraight>::solids, CompositeRow<StoragePremultiplied>::solids,
+    CompositeRow<StorageGray8>::solids,    CompositeRow<StorageRGB565>::solids
+};
+
+/* DISPATCH */
+
+void composite_span (pixel const* const src, PixelFormat const src_format, void* const dst, SpanFormat const dst_format, BlendMode const mode, int const n)
+{
+
+    if (n <= 0) return;
+
+    bool const premultiplied = dst_format == SPAN_ARGB8888_PREMULTIPLIED;
+    pixel const* source = src;
+
+    // Mixed formats: the row is converted to the target convention first
+    if (premultiplied != (src_format == PIXEL_PREMULTIPLIED))
+    {
+        static thread_local std::vector<pixel> converted;
+        converted.resize (n);
+
+        if (premultiplied) premultiply_span (src, converted.data(), n);
+        else               unpremultiply_span (src, converted.data(), n);
+
+        source = converted.data();
+    }
+
+    span_kernels[dst_format][mode] (source, dst, n);
+
+}
+
+void composite_solid (pixel const color, PixelFormat const color_format, void* const dst, SpanFormat const dst_format, BlendMode const mode, int const n)
+{
+
+    if (n <= 0) return;
+
+    bool const premultiplied = dst_format == SPAN_ARGB8888_PREMULTIPLIED;
+    pixel source = color;
+
+    if (premultiplied != (color_format == PIXEL_PREMULTIPLIED))
+    {
+        if (premultiplied) source = pixel_premultiply (color);
+        else               unpremultiply_span (&color, &source, 1);
+    }
+
+    solid_kernels[dst_format][mode] (source, dst, n);
+
+}
@@ -0,0 +1,205 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __COMPOSITE_HPP__
+#define __COMPOSITE_HPP__
+
+#include <cstring>
+#include "Pixmap.hpp"
+#include "Blend.hpp"
+#include "Fill.hpp"
+
+/* Compile-time compositing policies. A storage policy says how a pixel is stored (type, load to
+   ARGB, store from ARGB, premultiplied or not), a blend policy combines one source pixel with one
+   destination pixel in that convention. 'CompositeKernel <Storage, Blend>' expands the pair into
+   its own inner loop, and 'composite_span' / 'composite_solid' pick that loop from a table once
+   per call: nothing is tested per pixel.
+   The 32-bit copy and "over" kernels are specialized onto the SIMD spans (Blend.hpp, Fill.hpp),
+   the other pairs are the scalar loop below, which the compiler unrolls and vectorizes itself.
+   A new storage or blend mode is one more policy plus one more row or column of the tables. */
+
+enum SpanFormat {
+    SPAN_ARGB8888,               // Pixmap, PIXEL_STRAIGHT
+    SPAN_ARGB8888_PREMULTIPLIED, // Pixmap, PIXEL_PREMULTIPLIED
+    SPAN_GRAY8,                  // Graymap rows, BT.601 luma, opaque
+    SPAN_RGB565,                 // 16-bit textures (SDL_PIXELFORMAT_RGB565), opaque
+    SPAN_FORMAT_COUNT
+};
+
+inline SpanFormat span_format (PixelFormat const format)
+{
+    return (format == PIXEL_PREMULTIPLIED) ? SPAN_ARGB8888_PREMULTIPLIED : SPAN_ARGB8888;
+}
+
+// Source pixels are ARGB in 'src_format', converted once per call to the convention of 'dst_format'
+// (premultiplied for SPAN_ARGB8888_PREMULTIPLIED, straight for the others)
+void composite_span (pixel const* const src, PixelFormat const src_format, void* const dst, SpanFormat const dst_format, BlendMode const mode, int const n);
+void composite_solid (pixel const color, PixelFormat const color_format, void* const dst, SpanFormat const dst_format, BlendMode const mode, int const n);
+
+/* STORAGE POLICIES */
+
+inline pixcmp mul_255 (int const a, int const b) // a * b / 255, rounded like the blends
+{
+    return blend_component (a, 0, b);
+}
+
+struct StorageStraight {
+    typedef pixel stored;
+    static constexpr bool premultiplied = false;
+    static inline pixel load (stored const value) { return value; }
+    static inline stored store (pixel const value) { return value; }
+};
+
+struct StoragePremultiplied {
+    typedef pixel stored;
+    static constexpr bool premultiplied = true;
+    static inline pixel load (stored const value) { return value; }
+    static inline stored store (pixel const value) { return value; }
+};
+
+struct StorageGray8 {
+    typedef uint8_t stored;
+    static constexpr bool premultiplied = false;
+    static inline pixel load (stored const value) { return 0xFF000000 | (value * 0x010101); }
+    static inline stored store (pixel const value) // BT.601 weights of 'luma_span' (Gray.hpp), alpha dropped
+    {
+        return (9798 * ((value >> 16) & 0xFF) + 19235 * ((value >> 8) & 0xFF) + 3735 * (value & 0xFF) + (1 << 14)) >> 15;
+    }
+};
+
+struct StorageRGB565 {
+    typedef uint16_t stored;
+    static constexpr bool premultiplied = false;
+    static inline pixel load (stored const value) // The high bits are repeated into the low ones: 31 and 63 give 255
+    {
+        pixel const r = value >> 11, g = (value >> 5) & 0x3F, b = value & 0x1F;
+        return 0xFF000000 | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+    }
+    static inline stored store (pixel const value) // Rounded to the nearest level, alpha dropped
+    {
+        pixel const r = (((value >> 16) & 0xFF) * 31 + 127) / 255;
+        pixel const g = (((value >> 8) & 0xFF) * 63 + 127) / 255;
+        pixel const b = ((value & 0xFF) * 31 + 127) / 255;
+        return (r << 11) | (g << 5) | b;
+    }
+};
+
+/* BLEND POLICIES */
+
+// 's' and 'd' are ARGB in the storage convention, the result too
+
+struct BlendCopy {
+    template <bool premultiplied>
+    static inline pixel apply (pixel const s, pixel const) { return s; }
+};
+
+struct BlendOver {
+    template <bool premultiplied>
+    static inline pixel apply (pixel const s, pixel const d)
+    {
+        pixel out = d;
+        if (premultiplied) pixel_put_alpha_premultiplied (s, &out);
+        else               pixel_put_alpha (s, &out);
+        return out;
+    }
+};
+
+struct BlendAdd { // Premultiplied: s + d. Straight: the colour scaled by its alpha is added
+    template <bool premultiplied>
+    static inline pixel apply (pixel const s, pixel const d)
+    {
+        int const sa = s >> 24;
+        pixel out = 0;
+
+        for (int c = 0; c < 32; c += 8)
+        {
+            int const sc = (s >> c) & 0xFF;
+            int const v = ((d >> c) & 0xFF) + ((premultiplied || c == 24) ? sc : mul_255 (sc, sa));
+            out |= (pixel) (v > 255 ? 255 : v) << c;
+        }
+
+        return out;
+    }
+};
+
+struct BlendMultiply { // Premultiplied: s*d + s*(1 - da) + d*(1 - sa). Straight: s*d mixed into d by the source alpha
+    template <bool premultiplied>
+    static inline pixel apply (pixel const s, pixel const d)
+    {
+        int const sa = s >> 24;
+        int const da = d >> 24;
+        pixel out = 0;
+
+        for (int c = 0; c < 24; c += 8)
+        {
+            int const sc = (s >> c) & 0xFF;
+            int const dc = (d >> c) & 0xFF;
+
+            int v;
+            if (premultiplied) v = mul_255 (sc, dc) + mul_255 (sc, 255 - da) + mul_255 (dc, 255 - sa);
+            else               v = blend_component (mul_255 (sc, dc), dc, sa);
+
+            out |= (pixel) (v > 255 ? 255 : v) << c;
+        }
+
+        // Alpha composes like "over"
+        int const a = premultiplied ? sa + mul_255 (da, 255 - sa) : blend_component (sa, da, sa);
+
+        return out | ((pixel) a << 24);
+    }
+};
+
+/* KERNELS */
+
+template <class Storage, class Blend>
+struct CompositeKernel {
+
+    static void span (pixel const* const src, void* const dst, int const n)
+    {
+        typename Storage::stored* const out = (typename Storage::stored*) dst;
+
+        for (int i = 0; i < n; i++)
+            out[i] = Storage::store (Blend::template apply<Storage::premultiplied> (src[i], Storage::load (out[i])));
+    }
+
+    static void solid (pixel const color, void* const dst, int const n)
+    {
+        typename Storage::stored* const out = (typename Storage::stored*) dst;
+
+        for (int i = 0; i < n; i++)
+            out[i] = Storage::store (Blend::template apply<Storage::premultiplied> (color, Storage::load (out[i])));
+    }
+
+};
+
+// 32-bit copies and "over": the SIMD spans, bit-identical to the scalar policies above
+
+template <class Storage>
+struct CompositeKernel32Copy {
+    static void span (pixel const* const src, void* const dst, int const n) { std::memcpy (dst, src, n * sizeof (pixel)); }
+    static void solid (pixel const color, void* const dst, int const n) { fill_span ((pixel*) dst, color, n); }
+};
+
+template <> struct CompositeKernel<StorageStraight, BlendCopy> : CompositeKernel32Copy<StorageStraight> {};
+template <> struct CompositeKernel<StoragePremultiplied, BlendCopy> : CompositeKernel32Copy<StoragePremultiplied> {};
+
+template <>
+struct CompositeKernel<StorageStraight, BlendOver> {
+    static void span (pixel const* const src, void* const dst, int const n) { blend_span (src, (pixel*) dst, n); }
+    static void solid (pixel const color, void* const dst, int const n) { blend_span_solid (color, (pixel*) dst, n); }
+};
+
+template <>
+struct CompositeKernel<StoragePremultiplied, BlendOver> {
+    static void span (pixel const* const src, void* const dst, int const n) { blend_span_premultiplied (src, (pixel*) dst, n); }
+    static void solid (pixel const color, void* const dst, int const n) { blend_span_solid_premultiplied (color, (pixel*) dst, n); }
+};
+
+#endif
@@ -0,0 +1,437 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <SDL2/SDL.h>
+#include "DrawList.hpp"
+#include "Gradient.hpp"
+#include "Composite.hpp"
+#include "Profile.hpp"
+
+/* Commands resolved against the target: clipped, with their final colour or ramp */
+
+struct ResolvedCommand {
+
+  DrawCommandType type;
+  Rectbox r;                    // Clipped, inclusive
+  bool opaque;                  // Hides what was drawn below it
+  pixel color;                  // Rect: written or blended as is
+  int ramp;                     // Gradient: offset of its ramp in 'ramps'
+  GradientDirection direction;
+  Pixmap const* source;
+  int x1; int y1;               // Blit: position of the source top-left corner
+
+};
+
+struct CommandSpan {
+    int command; // Index in the resolved commands
+    int x1;      // [x1, x2) on the scanline
+    int x2;
+};
+
+DrawList::DrawList ()
+{
+    this -> culled = 0;
+}
+
+/* RECORDING */
+
+void DrawList::add_rect (Rectbox const &rect, pixel const color)
+{
+    add_rect (rect, color, 255);
+}
+
+void DrawList::add_rect (Rectbox const &rect, pixel const color, pixcmp const coverage)
+{
+    commands.push_back ({DRAW_RECT, rect, color, coverage, nullptr, nullptr});
+}
+
+void DrawList::add_gradient (Gradient const &gradient, Rectbox const &rect)
+{
+    commands.push_back ({DRAW_GRADIENT, rect, 0, 255, &gradient, nullptr});
+}
+
+void DrawList::add_blit (Pixmap const &source, int const x1, int const y1)
+{
+    commands.push_back ({DRAW_BLIT, Rectbox (x1, y1, x1, y1), 0, 255, nullptr, &source});
+}
+
+void DrawList::clear ()
+{
+    commands.clear();
+}
+
+int DrawList::get_command_count () const
+{
+    return (int) commands.size();
+}
+
+int DrawList::get_culled_count () const
+{
+    return culled;
+}
+
+/* SCANLINE SPANS */
+
+// Appends the parts of [x1, x2) not in 'covered' (sorted, disjoint) to 'visible'
+static void subtract_covered (std::vector<CommandSpan> const &covered, int const command, int const x1, int const x2, std::vector<CommandSpan> &visible)
+{
+    int x = x1;
+
+    for (CommandSpan const &c : covered)
+    {
+        if (c.x2 <= x) continue;
+        if (c.x1 >= x2) break;
+
+        if (c.x1 > x) visible.push_back ({command, x, c.x1});
+        x = c.x2;
+
+        if (x >= x2) return;
+    }
+
+    if (x < x2) visible.push_back ({command, x, x2});
+}
+
+// Adds [x1, x2) to 'covered', merging what overlaps or touches
+static void insert_covered (std::vector<CommandSpan> &covered, int x1, int x2)
+{
+    size_t i = 0;
+    while (i < covered.size() && covered[i].x2 < x1) i++;
+
+    size_t j = i;
+    while (j < covered.size() && covered[j].x1 <= x2)
+    {
+        x1 = std::min (x1, covered[j].x1);
+        x2 = std::max (x2, covered[j].x2);
+        j++;
+    }
+
+    if (j == i) { covered.insert (covered.begin() + i, {-1, x1, x2}); return; }
+
+    // Usually extends a single interval (neighbour commands)
+    covered[i].x1 = x1;
+    covered[i].x2 = x2;
+    covered.erase (covered.begin() + i + 1, covered.begin() + j);
+}
+
+/* EXECUTION */
+
+void DrawList::execute (Pixmap &pix)
+{
+
+    culled = 0;
+
+    std::vector<ResolvedCommand> resolved;
+    std::vector<pixel> ramps; // Copied: commands sharing a gradient may need ramps of different lengths
+    resolved.reserve (commands.size());
+
+    int y_min = pix.height, y_max = -1;
+    int x_min = pix.width,  x_max = -1; // Columns the commands cover, for the band split
+
+    #ifdef PIXMAP_PROFILE
+        long long area = 0; // Pixels covered by the commands, before culling
+    #endif
+
+    for (DrawCommand const &command : commands)
+    {
+
+        ResolvedCommand c;
+        c.type = command.type;
+        c.r = command.rect;
+        c.color = 0;
+        c.ramp = 0;
+        c.direction = GRADIENT_VERTICAL;
+        c.source = command.source;
+        c.x1 = command.rect.x1;
+        c.y1 = command.rect.y1;
+
+        if (command.type == DRAW_RECT)
+        {
+
+            // Exactly the clipping and colour rules of 'draw_rectbox' ('int_restrict', inlined)
+            c.r.x1 = std::min (std::max (c.r.x1, 0), pix.width  - 1);
+            c.r.y1 = std::min (std::max (c.r.y1, 0), pix.height - 1);
+            c.r.x2 = std::min (std::max (c.r.x2, 0), pix.width  - 1);
+            c.r.y2 = std::min (std::max (c.r.y2, 0), pix.height - 1);
+
+            if ((c.r.x1 >= c.r.x2) || (c.r.y1 >= c.r.y2)) continue;
+
+            int const color_alpha = pix.with_alpha ? (command.color >> 24) : 255;
+            int const alpha = (color_alpha * command.coverage + 127) / 255;
+
+            if (alpha == 0) continue;
+
+            c.opaque = alpha == 255;
+            c.color  = command.color;
+
+            if (!c.opaque)
+            {
+                pixel const front = (command.color & 0x00FFFFFF) | ((pixel) alpha << 24);
+                c.color = (pix.format == PIXEL_PREMULTIPLIED) ? pixel_premultiply (front) : front;
+            }
+
+        }
+        else if (command.type == DRAW_GRADIENT)
+        {
+
+            if (!pix.clip_rect (&c.r)) continue;
+
+            Gradient const &gradient = *command.gradient;
+
+            int const w = c.r.x2 - c.r.x1 + 1;
+            int const h = c.r.y2 - c.r.y1 + 1;
+
+            c.direction = gradient.direction;
+            c.opaque = !pix.with_alpha || gradient.opaque;
+
+            int const length = (c.direction == GRADIENT_VERTICAL) ? h : (c.direction == GRADIENT_HORIZONTAL) ? w : w + h - 1;
+
+            c.ramp = (int) ramps.size();
+            ramps.resize (ramps.size() + length);
+            gradient.copy_ramp (length, ramps.data() + c.ramp);
+
+            if (!c.opaque && pix.format == PIXEL_PREMULTIPLIED) premultiply_span (ramps.data() + c.ramp, ramps.data() + c.ramp, length);
+
+        }
+        else
+        {
+
+            Pixmap const &source = *command.source;
+            if (source.width <= 0 || source.height <= 0) continue;
+
+            c.r.setter (c.x1, c.y1, c.x1 + source.width - 1, c.y1 + source.height - 1);
+            if (!pix.clip_rect (&c.r)) continue;
+
+            c.opaque = !source.with_alpha; // Copied, like 'blit_line'
+
+        }
+
+        pix.add_damage (c.r);
+        resolved.push_back (c);
+
+        y_min = std::min (y_min, c.r.y1);
+        y_max = std::max (y_max, c.r.y2);
+        x_min = std::min (x_min, c.r.x1);
+        x_max = std::max (x_max, c.r.x2);
+
+        #ifdef PIXMAP_PROFILE
+            area += (long long) (c.r.x2 - c.r.x1 + 1) * (c.r.y2 - c.r.y1 + 1);
+        #endif
+
+    }
+
+    if (y_max < y_min) return;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_DRAW_LIST, area, area * sizeof (pixel));
+
+    // Commands by first row (recording order among equals), usually recorded that way already
+    std::vector<int> order (resolved.size());
+    for (int i = 0; i < (int) order.size(); i++) order[i] = i;
+
+    auto const starts_before = [&] (int const a, int const b) { return resolved[a].r.y1 < resolved[b].r.y1; };
+    if (!std::is_sorted (order.begin(), order.end(), starts_before)) std::stable_sort (order.begin(), order.end(), starts_before);
+
+    SpanFormat const target = span_format (pix.format);
+    std::atomic<int> hidden_total (0);
+
+    pix.for_each_band (y_max - y_min + 1, x_max - x_min + 1, [&] (int const band_begin, int const band_end)
+    {
+
+        int const y_begin = y_min + band_begin;
+        int const y_end   = y_min + band_end;
+
+        std::vector<int> active, added, merged_active; // Commands on the current row, in recording order
+        std::vector<CommandSpan> covered, visible, spans, runs;
+        int hidden = 0, row_hidden = 0;
+        bool solid = false;  // Every span is an opaque rect: the row does not depend on what was below
+        bool repeat = false; // Same spans as the previous row of the band
+
+        // Commands started above the band and still running
+        size_t next = 0;
+        while (next < order.size() && resolved[order[next]].r.y1 < y_begin)
+        {
+            if (resolved[order[next]].r.y2 >= y_begin) active.push_back (order[next]);
+            next++;
+        }
+
+        std::sort (active.begin(), active.end());
+        bool changed = true;
+        int first_end = y_begin - 1; // Last row of the active command that ends first (refreshed with the spans)
+
+        for (int y = y_begin; y < y_end; y++)
+        {
+
+            // The active set, so the spans, only change where a command starts or ends
+            if (y > first_end)
+            {
+                size_t const count = active.size();
+                active.erase (std::remove_if (active.begin(), active.end(), [&] (int const i) { return resolved[i].r.y2 < y; }), active.end());
+                changed = changed || active.size() != count;
+            }
+
+            added.clear();
+            while (next < order.size() && resolved[order[next]].r.y1 == y) added.push_back (order[next++]);
+
+            if (!added.empty())
+            {
+                std::sort (added.begin(), added.end());
+                merged_active.resize (active.size() + added.size());
+                std::merge (active.begin(), active.end(), added.begin(), added.end(), merged_active.begin());
+                active.swap (merged_active);
+                changed = true;
+            }
+
+            if (changed)
+            {
+
+                changed = false;
+                covered.clear();
+                visible.clear();
+                row_hidden = 0;
+
+                first_end = y_end;
+                for (int const i : active) first_end = std::min (first_end, resolved[i].r.y2);
+
+                // Back to front: what a later opaque command covers is never drawn
+                for (int k = (int) active.size() - 1; k >= 0; k--)
+                {
+                    ResolvedCommand const &c = resolved[active[k]];
+                    size_t const before = visible.size();
+
+                    subtract_covered (covered, active[k], c.r.x1, c.r.x2 + 1, visible);
+
+                    if (visible.size() == before) row_hidden++;
+                    if (c.opaque) insert_covered (covered, c.r.x1, c.r.x2 + 1);
+                }
+
+                // Visible opaque spans never overlap each other and translucent ones only lie over
+                // earlier commands: opaque spans first (sorted by x), then translucent ones in order.
+                spans.clear();
+
+                for (CommandSpan const &s : visible)
+                    if (resolved[s.command].opaque) spans.push_back (s);
+
+                // Gathered back to front: commands recorded left to right come out already sorted once reversed
+                std::reverse (spans.begin(), spans.end());
+
+                auto const left_first = [] (CommandSpan const &a, CommandSpan const &b) { return a.x1 < b.x1; };
+                if (!std::is_sorted (spans.begin(), spans.end(), left_first)) std::sort (spans.begin(), spans.end(), left_first);
+
+                size_t merged = 0;
+                for (size_t i = 0; i < spans.size(); i++)
+                {
+                    ResolvedCommand const &c = resolved[spans[i].command];
+
+                    if (merged > 0)
+                    {
+                        CommandSpan &last = spans[merged - 1];
+                        ResolvedCommand const &l = resolved[last.command];
+
+                        // Touching solid rects of the same colour: one fill
+                        if (c.type == DRAW_RECT && l.type == DRAW_RECT && l.color == c.color && last.x2 == spans[i].x1)
+                        {
+                            last.x2 = spans[i].x2;
+                            continue;
+                        }
+                    }
+
+                    spans[merged++] = spans[i];
+                }
+
+                spans.resize (merged);
+
+                // Solid rows are repeated by copying the runs of touching spans from the row above
+                runs.clear();
+                solid = true;
+
+                for (CommandSpan const &s : spans)
+                {
+                    if (resolved[s.command].type != DRAW_RECT) solid = false;
+
+                    if (!runs.empty() && runs.back().x2 == s.x1) runs.back().x2 = s.x2;
+                    else                                          runs.push_back (s);
+                }
+
+                for (int k = (int) visible.size() - 1; k >= 0; k--)
+                    if (!resolved[visible[k].command].opaque) { spans.push_back (visible[k]); solid = false; }
+
+                repeat = false;
+
+            }
+
+            hidden += row_hidden;
+
+            pixel* const row = pix.datas + y * pix.stride;
+
+            if (solid && repeat)
+            {
+                for (CommandSpan const &s : runs)
+                    std::memcpy (row + s.x1, row - pix.stride + s.x1, (s.x2 - s.x1) * sizeof (pixel));
+
+                continue;
+            }
+
+            repeat = true;
+
+            for (CommandSpan const &s : spans)
+            {
+
+                ResolvedCommand const &c = resolved[s.command];
+                pixel* const dst = row + s.x1;
+                int const n = s.x2 - s.x1;
+
+                // Resolved colours and ramps are already in the target format, so are opaque sources
+                BlendMode const mode = c.opaque ? BLEND_COPY : BLEND_OVER;
+
+                if (c.type == DRAW_RECT)
+                {
+                    composite_solid (c.color, pix.format, dst, target, mode, n);
+                }
+                else if (c.type == DRAW_GRADIENT)
+                {
+                    int const dy = y - c.r.y1;
+                    pixel const* const ramp = ramps.data() + c.ramp;
+
+                    if (c.direction == GRADIENT_VERTICAL)
+                    {
+                        composite_solid (ramp[dy], pix.format, dst, target, mode, n);
+                    }
+                    else
+                    {
+                        pixel const* const src = ramp + (s.x1 - c.r.x1) + ((c.direction == GRADIENT_DIAGONAL) ? dy : 0);
+                        composite_span (src, pix.format, dst, target, mode, n);
+                    }
+                }
+                else
+                {
+                    Pixmap const &source = *c.source;
+                    pixel const* const src = source.datas + (y - c.y1) * source.stride + (s.x1 - c.x1);
+
+                    composite_span (src, c.opaque ? pix.format : source.format, dst, target, mode, n);
+                }
+
+            }
+
+        }
+
+        hidden_total += hidden;
+
+    });
+
+    culled = hidden_total;
+
+    #ifdef DEBUG
+        std::cout << "DrawList::execute > " << resolved.size() << " commands, " << culled << " hidden spans skipped." << std::endl;
+    #endif
+
+}
@@ -0,0 +1,63 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __DRAWLIST_HPP__
+#define __DRAWLIST_HPP__
+
+#include <vector>
+#include "Pixmap.hpp"
+
+/* Deferred drawing: the commands are recorded, then executed together one scanline at a time.
+   On each scanline, the parts of a command hidden by a later opaque command are never drawn,
+   opaque rect spans of the same colour that touch are written by a single fill, and the
+   scanlines are split in bands over the executor of the pixmap (Pixmap::set_executor).
+   The result is the same as issuing the calls directly, in the recording order. */
+
+enum DrawCommandType {
+    DRAW_RECT,      // 'draw_rectbox'
+    DRAW_GRADIENT,  // 'draw_gradient' (the retained output of a cached gradient is not used)
+    DRAW_BLIT       // 'blit_line' of every line of a pixmap
+};
+
+struct DrawCommand {
+
+  DrawCommandType type;
+  Rectbox rect;            // As given, clipped when executed
+  pixel color;
+  pixcmp coverage;
+  Gradient const* gradient; // Not owned, must live until 'execute'
+  Pixmap const* source;     // Not owned, must live until 'execute'
+
+};
+
+class DrawList {
+
+  private:
+    std::vector<DrawCommand> commands;
+
+    int culled; // Spans of the last 'execute' not drawn because they were hidden
+
+  public:
+    DrawList ();
+
+    void add_rect (Rectbox const &rect, pixel const color);                         // Same result as 'draw_rectbox'
+    void add_rect (Rectbox const &rect, pixel const color, pixcmp const coverage);
+    void add_gradient (Gradient const &gradient, Rectbox const &rect);
+    void add_blit (Pixmap const &source, int const x1, int const y1); // Top-left corner of 'source' on the target
+
+    void clear ();
+    int get_command_count () const;
+    int get_culled_count () const; // Hidden command spans skipped by the last 'execute' (one per scanline)
+
+    void execute (Pixmap &pix); // Draws every command in order, the list is kept (call 'clear' to reuse it)
+
+};
+
+#endif
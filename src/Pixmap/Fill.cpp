@@ -0,0 +1,154 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include "Fill.hpp"
+
+#if defined (__x86_64__) || defined (__i386__)
+  #include <immintrin.h>
+  #define PIXMAP_X86
+#endif
+
+typedef void (*fill_span_fn) (pixel* const dst, pixel const color, int const n);
+
+/* SCALAR */
+
+static void fill_span_scalar (pixel* const dst, pixel const color, int const n)
+{
+    for (int i = 0; i < n; i++)
+        dst[i] = color;
+}
+
+#ifdef PIXMAP_X86
+
+/* SSE2 */
+
+__attribute__ ((target ("sse2")))
+static void fill_span_sse2 (pixel* const dst, pixel const color, int const n)
+{
+    __m128i const c = _mm_set1_epi32 ((int) color);
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm_storeu_si128 ((__m128i*) (dst + i), c);
+        _mm_storeu_si128 ((__m128i*) (dst + i + 4), c);
+    }
+
+    fill_span_scalar (dst + i, color, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void fill_span_stream_sse2 (pixel* const dst, pixel const color, int const n)
+{
+    __m128i const c = _mm_set1_epi32 ((int) color);
+
+    int i = 0;
+
+    // Streaming stores need 16-byte alignment: scalar head up to it
+    while (i < n && ((uintptr_t) (dst + i) & 15)) dst[i++] = color;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm_stream_si128 ((__m128i*) (dst + i), c);
+        _mm_stream_si128 ((__m128i*) (dst + i + 4), c);
+    }
+
+    fill_span_scalar (dst + i, color, n - i);
+}
+
+/* AVX2 */
+
+__attribute__ ((target ("avx2")))
+static void fill_span_avx2 (pixel* const dst, pixel const color, int const n)
+{
+    __m256i const c = _mm256_set1_epi32 ((int) color);
+
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        _mm256_storeu_si256 ((__m256i*) (dst + i), c);
+        _mm256_storeu_si256 ((__m256i*) (dst + i + 8), c);
+    }
+
+    fill_span_sse2 (dst + i, color, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+static void fill_span_stream_avx2 (pixel* const dst, pixel const color, int const n)
+{
+    __m256i const c = _mm256_set1_epi32 ((int) color);
+
+    int i = 0;
+
+    while (i < n && ((uintptr_t) (dst + i) & 31)) dst[i++] = color;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        _mm256_stream_si256 ((__m256i*) (dst + i), c);
+        _mm256_stream_si256 ((__m256i*) (dst + i + 8), c);
+    }
+
+    fill_span_scalar (dst + i, color, n - i);
+}
+
+#endif
+
+/* RUNTIME DISPATCH */
+
+static fill_span_fn select_fill_span ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return fill_span_avx2;
+        if (__builtin_cpu_supports ("sse2")) return fill_span_sse2;
+    #endif
+    return fill_span_scalar;
+}
+
+// The streamed rows are made visible to the other threads once, after the last one
+static void fill_stream_fence ()
+{
+    #ifdef PIXMAP_X86
+        _mm_sfence();
+    #endif
+}
+
+static fill_span_fn select_fill_span_stream ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return fill_span_stream_avx2;
+        if (__builtin_cpu_supports ("sse2")) return fill_span_stream_sse2;
+    #endif
+    return fill_span_scalar;
+}
+
+void fill_span (pixel* const dst, pixel const color, int const n)
+{
+    static fill_span_fn const fn = select_fill_span();
+    fn (dst, color, n);
+}
+
+void fill_span_stream (pixel* const dst, pixel const color, int const n)
+{
+    fill_rows_stream (dst, 0, color, n, 1);
+}
+
+void fill_rows_stream (pixel* const dst, int const stride, pixel const color, int const n, int const rows)
+{
+    static fill_span_fn const fn = select_fill_span_stream();
+
+    for (int y = 0; y < rows; y++)
+        fn (dst + y * stride, color, n);
+
+    fill_stream_fence();
+}
@@ -0,0 +1,26 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __FILL_HPP__
+#define __FILL_HPP__
+
+#include "Pixmap.hpp"
+
+/* Solid span stores, 4/8 pixels per store with SSE2/AVX2 selected at runtime.
+   'fill_span_stream' uses non-temporal stores: the data goes to memory without evicting the
+   cache, which is what large fills want since the next stage will not read it back soon. */
+
+#define FILL_STREAM_MIN_BYTES (4 * 1024 * 1024) // Whole fills above this size use 'fill_span_stream'
+
+void fill_span (pixel* const dst, pixel const color, int const n);
+void fill_span_stream (pixel* const dst, pixel const color, int const n); // Ends with a store fence
+void fill_rows_stream (pixel* const dst, int const stride, pixel const color, int const n, int const rows); // 'rows' spans 'stride' apart, one store fence at the end
+
+#endif
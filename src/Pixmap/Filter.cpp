@@ -0,0 +1,668 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "Pixmap.hpp"
+#include "Filter.hpp"
+#include "TiledPixmap.hpp"
+#include "ThreadPool.hpp"
+#include "Profile.hpp"
+
+#if defined (__x86_64__) || defined (__i386__)
+  #include <immintrin.h>
+  #define PIXMAP_X86
+#endif
+
+#define FILTER_FRAC_BITS 4 // Fractional bits kept between the horizontal and the vertical pass
+#define FILTER_H_SHIFT   (FILTER_TAP_BITS - FILTER_FRAC_BITS)
+#define FILTER_V_SHIFT   (FILTER_TAP_BITS + FILTER_FRAC_BITS)
+
+#define FILTER_TILE_ROWS           128          // Output rows of a tile: the 2 * radius halo rows are filtered again by each tile
+#define FILTER_TILE_MIN_COLUMNS    64
+#define FILTER_PARALLEL_MIN_PIXELS (128 * 128)  // Lower than for the per-pixel operations, a convolution costs a lot more per pixel
+
+/* KERNELS */
+
+SeparableKernel::SeparableKernel (std::vector<float> const &weights)
+{
+
+    if (weights.empty())
+    {
+        radius = 0;
+        taps.assign (1, 1 << FILTER_TAP_BITS); // Identity
+        return;
+    }
+
+    #ifdef DEBUG
+        if (weights.size() % 2 == 0) std::cout << "SeparableKernel::SeparableKernel > even tap count, last weight ignored." << std::endl;
+    #endif
+
+    radius = std::min (((int) weights.size() - 1) / 2, FILTER_MAX_RADIUS);
+
+    int const count = 2 * radius + 1;
+    int const first = ((int) weights.size() - 1) / 2 - radius; // Centred when the radius was capped
+
+    float sum_f = 0.0f;
+    int   sum_i = 0;
+
+    taps.resize (count);
+
+    for (int k = 0; k < count; k++)
+    {
+        float const w = weights[first + k];
+        taps[k] = (int) lroundf (w * (1 << FILTER_TAP_BITS));
+        sum_f += w;
+        sum_i += taps[k];
+    }
+
+    // A normalized kernel must leave flat areas unchanged: the rounding error goes to the centre tap
+    if (fabsf (sum_f - 1.0f) < 1e-3f) taps[radius] += (1 << FILTER_TAP_BITS) - sum_i;
+
+}
+
+SeparableKernel SeparableKernel::box (int const radius)
+{
+    int const r = std::max (0, std::min (radius, FILTER_MAX_RADIUS));
+    return SeparableKernel (std::vector<float> (2 * r + 1, 1.0f / (2 * r + 1)));
+}
+
+SeparableKernel SeparableKernel::gaussian (float const sigma)
+{
+
+    if (sigma <= 0.0f) return box (0);
+
+    int const r = std::min ((int) ceilf (3.0f * sigma), FILTER_MAX_RADIUS);
+
+    std::vector<float> weights (2 * r + 1);
+    float sum = 0.0f;
+
+    for (int k = -r; k <= r; k++)
+    {
+        weights[k + r] = expf (-(float) (k * k) / (2.0f * sigma * sigma));
+        sum += weights[k + r];
+    }
+
+    for (float &w : weights) w /= sum;
+
+    return SeparableKernel (weights);
+
+}
+
+int SeparableKernel::get_radius () const
+{
+    return radius;
+}
+
+/* BORDERS */
+
+int border_index (int i, int const n, BorderMode const border)
+{
+
+    if (i >= 0 && i < n) return i;
+
+    switch (border)
+    {
+        case BORDER_WRAP:
+            i %= n;
+            return i < 0 ? i + n : i;
+
+        case BORDER_MIRROR:
+        {
+            if (n == 1) return 0;
+            int const period = 2 * (n - 1);
+            i %= period;
+            if (i < 0) i += period;
+            return i < n ? i : period - i;
+        }
+
+        default:
+            return i < 0 ? 0 : n - 1;
+    }
+
+}
+
+/* PASSES */
+
+// Horizontal: 'src' holds n + count - 1 pixels, 'dst' gets 4 ints per pixel in memory order (B, G, R, A)
+typedef void (*convolve_row_fn) (pixel const* const src, int const* const taps, int const count, int* const dst, int const n);
+
+// Vertical: 'rows' are the 'count' horizontal results of the window, 'dst' gets n pixels
+typedef void (*convolve_column_fn) (int const* const* const rows, int const* const taps, int const count,
+                                    pixel* const dst, int const n, bool const absolute);
+
+/* SCALAR */
+
+static void convolve_row_scalar (pixel const* const src, int const* const taps, int const count, int* const dst, int const n)
+{
+    for (int x = 0; x < n; x++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int sum = 0;
+            for (int k = 0; k < count; k++)
+                sum += taps[k] * (int) ((src[x + k] >> (8 * c)) & 0xFF);
+            dst[4 * x + c] = (sum + (1 << (FILTER_H_SHIFT - 1))) >> FILTER_H_SHIFT;
+        }
+    }
+}
+
+static void convolve_column_from (int const* const* const rows, int const* const taps, int const count,
+                                  pixel* const dst, int const first, int const n, bool const absolute)
+{
+    for (int x = first; x < n; x++)
+    {
+        pixel p = 0;
+
+        for (int c = 0; c < 4; c++)
+        {
+            int sum = 0;
+            for (int k = 0; k < count; k++)
+                sum += taps[k] * rows[k][4 * x + c];
+
+            int v = (sum + (1 << (FILTER_V_SHIFT - 1))) >> FILTER_V_SHIFT;
+            if (absolute && v < 0) v = -v;
+            int_restrict (&v, 0, 255);
+
+            p |= (pixel) v << (8 * c);
+        }
+
+        dst[x] = p;
+    }
+}
+
+static void convolve_column_scalar (int const* const* const rows, int const* const taps, int const count,
+                                    pixel* const dst, int const n, bool const absolute)
+{
+    convolve_column_from (rows, taps, count, dst, 0, n, absolute);
+}
+
+#ifdef PIXMAP_X86
+
+/* SSE2 */
+
+// SSE2 has no 32-bit low multiply (pmulld is SSE4.1): two 32 x 32 -> 64 multiplies of the even
+// and odd lanes, low halves interleaved back. The low 32 bits are the same signed or unsigned
+__attribute__ ((target ("sse2")))
+static inline __m128i mullo_epi32_sse2 (__m128i const a, __m128i const b)
+{
+    __m128i const even = _mm_mul_epu32 (a, b);
+    __m128i const odd  = _mm_mul_epu32 (_mm_srli_si128 (a, 4), _mm_srli_si128 (b, 4));
+    return _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (0, 0, 2, 0)), _mm_shuffle_epi32 (odd, _MM_SHUFFLE (0, 0, 2, 0)));
+}
+
+__attribute__ ((target ("sse2")))
+static inline __m128i unpack_pair_sse2 (pixel const a, pixel const b) // Components of 'a' and 'b' interleaved as words
+{
+    return _mm_unpacklo_epi8 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 ((int) a), _mm_cvtsi32_si128 ((int) b)), _mm_setzero_si128());
+}
+
+__attribute__ ((target ("sse2")))
+static void convolve_row_sse2 (pixel const* const src, int const* const taps, int const count, int* const dst, int const n)
+{
+    // The components are 8-bit: pmaddwd multiplies them by two taps at once. A tap may not fit in
+    // 16 bits, so it is split as hi * 2^15 + lo (lo in [0, 2^15)) and the hi products shifted back
+    int const pairs = (count + 1) / 2;
+    __m128i lo[(2 * FILTER_MAX_RADIUS + 2) / 2], hi[(2 * FILTER_MAX_RADIUS + 2) / 2];
+
+    for (int j = 0; j < pairs; j++)
+    {
+        int const t0 = taps[2 * j];
+        int const t1 = (2 * j + 1 < count) ? taps[2 * j + 1] : 0; // Odd count: the last tap is paired with a zero
+        lo[j] = _mm_set1_epi32 ((int) ((pixel) (t0 & 0x7FFF) | ((pixel) (t1 & 0x7FFF) << 16)));
+        hi[j] = _mm_set1_epi32 ((int) (((pixel) (t0 >> 15) & 0xFFFF) | ((pixel) (t1 >> 15) << 16)));
+    }
+
+    __m128i const round = _mm_set1_epi32 (1 << (FILTER_H_SHIFT - 1));
+
+    int x = 0;
+
+    for (; x + 2 <= n; x += 2) // One pixel (4 components) per register
+    {
+        __m128i acc0 = _mm_setzero_si128(), high0 = _mm_setzero_si128();
+        __m128i acc1 = _mm_setzero_si128(), high1 = _mm_setzero_si128();
+
+        for (int j = 0; j < pairs; j++)
+        {
+            int const k1 = std::min (2 * j + 1, count - 1); // Zero tap for the padding
+            __m128i const p0 = unpack_pair_sse2 (src[x + 2 * j],     src[x + k1]);
+            __m128i const p1 = unpack_pair_sse2 (src[x + 2 * j + 1], src[x + k1 + 1]);
+
+            acc0  = _mm_add_epi32 (acc0,  _mm_madd_epi16 (p0, lo[j]));
+            high0 = _mm_add_epi32 (high0, _mm_madd_epi16 (p0, hi[j]));
+            acc1  = _mm_add_epi32 (acc1,  _mm_madd_epi16 (p1, lo[j]));
+            high1 = _mm_add_epi32 (high1, _mm_madd_epi16 (p1, hi[j]));
+        }
+
+        acc0 = _mm_add_epi32 (acc0, _mm_slli_epi32 (high0, 15));
+        acc1 = _mm_add_epi32 (acc1, _mm_slli_epi32 (high1, 15));
+
+        _mm_storeu_si128 ((__m128i*) (dst + 4 * x),     _mm_srai_epi32 (_mm_add_epi32 (acc0, round), FILTER_H_SHIFT));
+        _mm_storeu_si128 ((__m128i*) (dst + 4 * x + 4), _mm_srai_epi32 (_mm_add_epi32 (acc1, round), FILTER_H_SHIFT));
+    }
+
+    convolve_row_scalar (src + x, taps, count, dst + 4 * x, n - x);
+}
+
+__attribute__ ((target ("sse2")))
+static void convolve_column_sse2 (int const* const* const rows, int const* const taps, int const count,
+                                  pixel* const dst, int const n, bool const absolute)
+{
+    __m128i const round = _mm_set1_epi32 (1 << (FILTER_V_SHIFT - 1));
+
+    int x = 0;
+
+    for (; x + 4 <= n; x += 4)
+    {
+        __m128i acc[4];
+        for (int i = 0; i < 4; i++) acc[i] = _mm_setzero_si128();
+
+        for (int k = 0; k < count; k++)
+        {
+            __m128i const t = _mm_set1_epi32 (taps[k]);
+            for (int i = 0; i < 4; i++)
+                acc[i] = _mm_add_epi32 (acc[i], mullo_epi32_sse2 (_mm_loadu_si128 ((__m128i const*) (rows[k] + 4 * (x + i))), t));
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            acc[i] = _mm_srai_epi32 (_mm_add_epi32 (acc[i], round), FILTER_V_SHIFT);
+
+            if (absolute) // pabsd is SSSE3: (v ^ sign) - sign
+            {
+                __m128i const sign = _mm_srai_epi32 (acc[i], 31);
+                acc[i] = _mm_sub_epi32 (_mm_xor_si128 (acc[i], sign), sign);
+            }
+        }
+
+        // Saturating packs clamp to [0, 255]
+        __m128i const bytes = _mm_packus_epi16 (_mm_packs_epi32 (acc[0], acc[1]), _mm_packs_epi32 (acc[2], acc[3]));
+        _mm_storeu_si128 ((__m128i*) (dst + x), bytes);
+    }
+
+    convolve_column_from (rows, taps, count, dst, x, n, absolute);
+}
+
+/* AVX2 */
+
+__attribute__ ((target ("avx2")))
+static void convolve_row_avx2 (pixel const* const src, int const* const taps, int const count, int* const dst, int const n)
+{
+    __m256i const round = _mm256_set1_epi32 (1 << (FILTER_H_SHIFT - 1));
+
+    int x = 0;
+
+    for (; x + 4 <= n; x += 4) // Two pixels (8 components) per register
+    {
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+
+        for (int k = 0; k < count; k++)
+        {
+            __m256i const t  = _mm256_set1_epi32 (taps[k]);
+            __m256i const p0 = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((__m128i const*) (src + x + k)));
+            __m256i const p1 = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((__m128i const*) (src + x + k + 2)));
+            acc0 = _mm256_add_epi32 (acc0, _mm256_mullo_epi32 (p0, t));
+            acc1 = _mm256_add_epi32 (acc1, _mm256_mullo_epi32 (p1, t));
+        }
+
+        _mm256_storeu_si256 ((__m256i*) (dst + 4 * x),     _mm256_srai_epi32 (_mm256_add_epi32 (acc0, round), FILTER_H_SHIFT));
+        _mm256_storeu_si256 ((__m256i*) (dst + 4 * x + 8), _mm256_srai_epi32 (_mm256_add_epi32 (acc1, round), FILTER_H_SHIFT));
+    }
+
+    convolve_row_scalar (src + x, taps, count, dst + 4 * x, n - x);
+}
+
+__attribute__ ((target ("avx2")))
+static void convolve_column_avx2 (int const* const* const rows, int const* const taps, int const count,
+                                  pixel* const dst, int const n, bool const absolute)
+{
+    __m256i const round = _mm256_set1_epi32 (1 << (FILTER_V_SHIFT - 1));
+
+    int x = 0;
+
+    for (; x + 4 <= n; x += 4)
+    {
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+
+        for (int k = 0; k < count; k++)
+        {
+            __m256i const t = _mm256_set1_epi32 (taps[k]);
+            acc0 = _mm256_add_epi32 (acc0, _mm256_mullo_epi32 (_mm256_loadu_si256 ((__m256i const*) (rows[k] + 4 * x)), t));
+            acc1 = _mm256_add_epi32 (acc1, _mm256_mullo_epi32 (_mm256_loadu_si256 ((__m256i const*) (rows[k] + 4 * x + 8)), t));
+        }
+
+        acc0 = _mm256_srai_epi32 (_mm256_add_epi32 (acc0, round), FILTER_V_SHIFT);
+        acc1 = _mm256_srai_epi32 (_mm256_add_epi32 (acc1, round), FILTER_V_SHIFT);
+
+        if (absolute)
+        {
+            acc0 = _mm256_abs_epi32 (acc0);
+            acc1 = _mm256_abs_epi32 (acc1);
+        }
+
+        // Saturating packs clamp to [0, 255]; they work per lane, hence the permute
+        __m256i const words = _mm256_permute4x64_epi64 (_mm256_packs_epi32 (acc0, acc1), _MM_SHUFFLE (3, 1, 2, 0));
+        __m128i const bytes = _mm_packus_epi16 (_mm256_castsi256_si128 (words), _mm256_extracti128_si256 (words, 1));
+        _mm_storeu_si128 ((__m128i*) (dst + x), bytes);
+    }
+
+    convolve_column_from (rows, taps, count, dst, x, n, absolute);
+}
+
+#endif
+
+/* RUNTIME DISPATCH */
+
+static convolve_row_fn select_convolve_row ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return convolve_row_avx2;
+        if (__builtin_cpu_supports ("sse2")) return convolve_row_sse2;
+    #endif
+    return convolve_row_scalar;
+}
+
+static convolve_column_fn select_convolve_column ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return convolve_column_avx2;
+        if (__builtin_cpu_supports ("sse2")) return convolve_column_sse2;
+    #endif
+    return convolve_column_scalar;
+}
+
+/* ENGINE */
+
+void Pixmap::convolve_into (Pixmap &dst, SeparableKernel const &horizontal, SeparableKernel const &vertical,
+                            BorderMode const border, bool const absolute) const
+{
+
+    /* The image is cut into tiles of FILTER_TILE_ROWS rows and as many columns as let the
+       horizontal results of a full vertical window fit in FILTER_TILE_BYTES. In a tile, every
+       source row is filtered horizontally once into a ring of 2 * rv + 1 rows, and each output
+       row is the vertical pass over the ring. Tiles are independent (the halo rows are
+       recomputed), so they run on the executor in any order with the same result. */
+
+    static convolve_row_fn    const convolve_row    = select_convolve_row();
+    static convolve_column_fn const convolve_column = select_convolve_column();
+
+    if (datas == nullptr || width <= 0 || height <= 0) return;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_CONVOLVE, (long long) width * height, (long long) width * height * sizeof (pixel));
+
+    int const rh = horizontal.radius;
+    int const rv = vertical.radius;
+    int const window = 2 * rv + 1;
+
+    int const tile_w = std::min (width, std::max (FILTER_TILE_MIN_COLUMNS, FILTER_TILE_BYTES / (window * 4 * (int) sizeof (int))));
+
+    int const tiles_x = (width  + tile_w - 1) / tile_w;
+    int const tiles_y = (height + FILTER_TILE_ROWS - 1) / FILTER_TILE_ROWS;
+    int const tiles   = tiles_x * tiles_y;
+
+    std::function<void (int, int)> const job = [&] (int const t_begin, int const t_end)
+    {
+
+        thread_local std::vector<pixel> extended;   // Source row of the tile with the horizontal halo
+        thread_local std::vector<int> ring;
+        thread_local std::vector<int const*> rows;
+
+        for (int tile = t_begin; tile < t_end; tile++)
+        {
+
+            int const x0 = (tile % tiles_x) * tile_w;
+            int const x1 = std::min (x0 + tile_w, width);
+            int const y0 = (tile / tiles_x) * FILTER_TILE_ROWS;
+            int const y1 = std::min (y0 + FILTER_TILE_ROWS, height);
+            int const tw = x1 - x0;
+
+            extended.resize (tw + 2 * rh);
+            ring.resize ((size_t) window * tw * 4);
+            rows.resize (window);
+
+            int const in_begin = std::max (x0 - rh, 0);       // Columns read directly from the row
+            int const in_end   = std::min (x1 + rh, width);
+
+            for (int sy = y0 - rv; sy < y1 + rv; sy++)
+            {
+
+                pixel const* s_row = datas + border_index (sy, height, border) * stride;
+
+                for (int x = x0 - rh; x < in_begin; x++)
+                    extended[x - x0 + rh] = s_row[border_index (x, width, border)];
+
+                memcpy (extended.data() + (in_begin - x0 + rh), s_row + in_begin, (in_end - in_begin) * sizeof (pixel));
+
+                for (int x = in_end; x < x1 + rh; x++)
+                    extended[x - x0 + rh] = s_row[border_index (x, width, border)];
+
+                convolve_row (extended.data(), horizontal.taps.data(), 2 * rh + 1,
+                              ring.data() + (size_t) ((sy - y0 + rv) % window) * tw * 4, tw);
+
+                int const y = sy - rv; // Output row whose window ends with 'sy'
+                if (y < y0) continue;
+
+                for (int k = 0; k < window; k++)
+                    rows[k] = ring.data() + (size_t) ((y - y0 + k) % window) * tw * 4;
+
+                convolve_column (rows.data(), vertical.taps.data(), window, dst.datas + y * dst.stride + x0, tw, absolute);
+
+            }
+
+        }
+
+    };
+
+    if (executor != nullptr && executor -> get_thread_count() > 1 && tiles > 1 && width * height >= FILTER_PARALLEL_MIN_PIXELS)
+        executor -> parallel_for (tiles, tiles, job);
+    else
+        job (0, tiles);
+
+}
+
+void TiledPixmap::vertical_convolve (SeparableKernel const &kernel, BorderMode const border)
+{
+
+    /* The column pass of 'Pixmap::convolve' with a horizontal identity, run down each column
+       strip: a strip is contiguous, so its rows are widened to the intermediate precision in a
+       ring of 2 * radius + 1 rows of 'tile_size' pixels, and every output row is written back
+       in place. The strip is copied first, the wrap and mirror borders read rows already
+       written. Same result as 'Pixmap::convolve (box (0), kernel, border)'. */
+
+    static convolve_column_fn const convolve_column = select_convolve_column();
+
+    if (datas == nullptr) return;
+
+    int const radius = kernel.radius;
+    int const window = 2 * radius + 1;
+    int const n = tile_size * 4; // Components of a strip row, in memory order
+
+    for_each_index (tiles_x, [&] (int const strip)
+    {
+
+        thread_local std::vector<pixel> source;
+        thread_local std::vector<int> ring;
+        thread_local std::vector<int const*> rows;
+
+        pixel* const strip_ptr = get_pixel_adress (strip << tile_log2, 0);
+
+        source.assign (strip_ptr, strip_ptr + (size_t) height * tile_size);
+        ring.resize ((size_t) window * n);
+        rows.resize (window);
+
+        for (int sy = -radius; sy < height + radius; sy++)
+        {
+
+            pixcmp const* const s_row = (pixcmp const*) (source.data() + (size_t) border_index (sy, height, border) * tile_size);
+            int* const r_row = ring.data() + (size_t) ((sy + radius) % window) * n;
+
+            for (int i = 0; i < n; i++) // Vectorized by the compiler
+                r_row[i] = s_row[i] << FILTER_FRAC_BITS;
+
+            int const y = sy - radius; // Output row whose window ends with 'sy'
+            if (y < 0) continue;
+
+            for (int k = 0; k < window; k++)
+                rows[k] = ring.data() + (size_t) ((y + k) % window) * n;
+
+            convolve_column (rows.data(), kernel.taps.data(), window, strip_ptr + (size_t) y * tile_size, tile_size, false);
+
+        }
+
+    });
+
+}
+
+/* FILTERS */
+
+void Pixmap::convolve (SeparableKernel const &horizontal, SeparableKernel const &vertical, BorderMode const border)
+{
+    Pixmap scratch;
+    scratch.pool = pool; // With a pool, the copy reuses the previous call's buffer
+    convolve (horizontal, vertical, border, scratch);
+}
+
+void Pixmap::convolve (SeparableKernel const &horizontal, SeparableKernel const &vertical, BorderMode const border, Pixmap &scratch)
+{
+
+    if (datas == nullptr) return;
+
+    scratch.resize (width, height, with_alpha);
+
+    // The tiles read halo rows of their neighbours: the source is a copy, run on this executor
+    Pixmap source (scratch.datas, width, height, scratch.stride, with_alpha);
+    source.executor = executor;
+    source.copy_rows (*this);
+
+    add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+    source.convolve_into (*this, horizontal, vertical, border, false);
+
+}
+
+void Pixmap::gaussian_blur (float const sigma, BorderMode const border)
+{
+    Pixmap scratch;
+    scratch.pool = pool;
+    gaussian_blur (sigma, border, scratch);
+}
+
+void Pixmap::gaussian_blur (float const sigma, BorderMode const border, Pixmap &scratch)
+{
+    if (sigma <= 0.0f) return;
+
+    SeparableKernel const kernel = SeparableKernel::gaussian (sigma);
+    convolve (kernel, kernel, border, scratch);
+}
+
+void Pixmap::sharpen (float const amount, float const sigma, BorderMode const border)
+{
+    Pixmap scratch;
+    scratch.pool = pool;
+    sharpen (amount, sigma, border, scratch);
+}
+
+void Pixmap::sharpen (float const amount, float const sigma, BorderMode const border, Pixmap &scratch)
+{
+
+    if (datas == nullptr || sigma <= 0.0f) return;
+
+    SeparableKernel const kernel = SeparableKernel::gaussian (sigma);
+
+    scratch.resize (width, height, with_alpha);
+    Pixmap blurred (scratch.datas, width, height, scratch.stride, with_alpha);
+
+    convolve_into (blurred, kernel, kernel, border, false);
+
+    int const gain = (int) lroundf (amount * 256.0f); // 8.8 fixed point
+
+    add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+    for_each_band (height, width, [&] (int const y_begin, int const y_end)
+    {
+        for (int y = y_begin; y < y_end; y++)
+        {
+            pixel* p_ptr = datas + y * stride;
+            pixel const* b_ptr = blurred.datas + y * blurred.stride;
+
+            for (int x = 0; x < width; x++)
+            {
+                pixel out = p_ptr[x] & 0xFF000000; // Only the colour is sharpened
+                int const limit = (format == PIXEL_PREMULTIPLIED) ? (int) (p_ptr[x] >> 24) : 255; // Premultiplied colour stays <= alpha
+
+                for (int c = 0; c < 24; c += 8)
+                {
+                    int const s = (p_ptr[x] >> c) & 0xFF;
+                    int const b = (b_ptr[x] >> c) & 0xFF;
+                    int v = s + ((gain * (s - b) + 128) >> 8);
+                    int_restrict (&v, 0, limit);
+                    out |= (pixel) v << c;
+                }
+
+                p_ptr[x] = out;
+            }
+        }
+    });
+
+}
+
+void Pixmap::edge_detect (BorderMode const border)
+{
+    Pixmap scratch;
+    scratch.pool = pool;
+    edge_detect (border, scratch);
+}
+
+void Pixmap::edge_detect (BorderMode const border, Pixmap &scratch)
+{
+
+    if (datas == nullptr) return;
+
+    static SeparableKernel const derivative ({ -1.0f, 0.0f, 1.0f });
+    static SeparableKernel const smoothing  ({  1.0f, 2.0f, 1.0f });
+
+    // Both gradients in one buffer: |Gx| in the upper half, |Gy| in the lower one
+    scratch.resize (width, 2 * height, with_alpha);
+    Pixmap gx (scratch.datas, width, height, scratch.stride, with_alpha);
+    Pixmap gy (scratch.datas + height * scratch.stride, width, height, scratch.stride, with_alpha);
+
+    convolve_into (gx, derivative, smoothing, border, true);
+    convolve_into (gy, smoothing, derivative, border, true);
+
+    add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+    for_each_band (height, width, [&] (int const y_begin, int const y_end)
+    {
+        for (int y = y_begin; y < y_end; y++)
+        {
+            pixel* p_ptr = datas + y * stride;
+            pixel const* x_ptr = gx.datas + y * gx.stride;
+            pixel const* y_ptr = gy.datas + y * gy.stride;
+
+            for (int x = 0; x < width; x++)
+            {
+                pixel out = p_ptr[x] & 0xFF000000;
+
+                for (int c = 0; c < 24; c += 8)
+                    out |= (pixel) std::min (255u, ((x_ptr[x] >> c) & 0xFF) + ((y_ptr[x] >> c) & 0xFF)) << c;
+
+                p_ptr[x] = out;
+            }
+        }
+    });
+
+}
@@ -0,0 +1,47 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __FILTER_HPP__
+#define __FILTER_HPP__
+
+#include <vector>
+#include "Pixmap.hpp"
+
+#define FILTER_TAP_BITS   14            // Taps are fixed-point, 1.0 = 1 << FILTER_TAP_BITS
+#define FILTER_MAX_RADIUS 128
+#define FILTER_TILE_BYTES (256 * 1024)  // Horizontal results kept per tile, sized for L2
+
+/* One-dimensional kernel of 2 * radius + 1 taps, applied once horizontally and once vertically
+   by 'Pixmap::convolve'. The intermediate rows keep 4 fractional bits, so the product of the
+   horizontal and vertical gains (sums of |tap|) must stay below 32 to avoid overflow. */
+
+class SeparableKernel {
+
+  friend class Pixmap;
+  friend class TiledPixmap;
+
+  private:
+    std::vector<int> taps;
+    int radius;
+
+  public:
+    // Odd count, centred: of an even count, the last weight is ignored. Weights summing to 1 give taps summing exactly to 1.0
+    SeparableKernel (std::vector<float> const &weights);
+
+    static SeparableKernel box (int const radius);
+    static SeparableKernel gaussian (float const sigma); // Radius ceil (3 * sigma)
+
+    int get_radius () const;
+
+};
+
+int border_index (int i, int const n, BorderMode const border); // Maps any coordinate into [0, n)
+
+#endif
@@ -0,0 +1,234 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <SDL2/SDL.h>
+#include "Gradient.hpp"
+#include "Blend.hpp"
+#include "Composite.hpp"
+#include "Profile.hpp"
+
+/* GRADIENT */
+
+Gradient::Gradient (GradientDirection const direction, pixel const c_start, pixel const c_end)
+{
+    this -> direction = direction;
+    this -> cached = false;
+    this -> version = 1;
+    this -> ramp_version = 0;
+    this -> retained_version = 0;
+
+    stops.push_back ({0.0f, c_start});
+    stops.push_back ({1.0f, c_end});
+
+    opaque = (c_start >> 24) == 0xFF && (c_end >> 24) == 0xFF;
+}
+
+Gradient::Gradient (Gradient const &gradient)
+{
+    this -> version = 1;
+    this -> ramp_version = 0;
+    this -> retained_version = 0;
+    *this = gradient;
+}
+
+Gradient& Gradient::operator= (Gradient const &gradient)
+{
+    if (this == &gradient) return *this;
+
+    direction = gradient.direction;
+    stops = gradient.stops;
+    opaque = gradient.opaque;
+    cached = gradient.cached;
+    ++version; // Whatever this gradient cached before no longer applies
+
+    return *this;
+}
+
+void Gradient::add_stop (float const position, pixel const color)
+{
+    GradientStop const stop = {std::min (std::max (position, 0.0f), 1.0f), color};
+
+    auto const it = std::upper_bound (stops.begin(), stops.end(), stop,
+                                      [] (GradientStop const &a, GradientStop const &b) { return a.position < b.position; });
+    stops.insert (it, stop);
+
+    opaque = opaque && (color >> 24) == 0xFF;
+    ++version;
+}
+
+void Gradient::set_direction (GradientDirection const direction)
+{
+    this -> direction = direction;
+    ++version;
+}
+
+void Gradient::set_cached (bool const enabled)
+{
+    std::lock_guard<std::mutex> lock (cache_lock);
+
+    cached = enabled;
+    if (!enabled) retained = Pixmap();
+    retained_version = 0;
+}
+
+GradientDirection Gradient::get_direction () const
+{
+    return direction;
+}
+
+bool Gradient::is_opaque () const
+{
+    return opaque;
+}
+
+void Gradient::copy_ramp (int const length, pixel* const out) const
+{
+
+    std::lock_guard<std::mutex> lock (cache_lock);
+
+    if (ramp_version == version && (int) ramp.size() == length)
+    {
+        std::memcpy (out, ramp.data(), length * sizeof (pixel));
+        return;
+    }
+
+    ramp.resize (length);
+
+    int const last = length - 1;
+
+    for (size_t k = 0; k + 1 < stops.size(); k++)
+    {
+
+        // Segment [i0, i1] of the ramp between two stops, the next segment starts at i1
+        int const i0 = (int) (stops[k].position * last + 0.5f);
+        int const i1 = (int) (stops[k + 1].position * last + 0.5f);
+
+        if (k == 0)
+            for (int i = 0; i < i0; i++) ramp[i] = stops[0].color;
+
+        if (k + 2 == stops.size())
+            for (int i = i1; i < length; i++) ramp[i] = stops[k + 1].color;
+
+        if (i1 <= i0) { if (i0 < length) ramp[i0] = stops[k + 1].color; continue; }
+
+        pixcmp c0[4], c1[4];
+        pixel_get_rgba (stops[k].color,     &c0[0], &c0[1], &c0[2], &c0[3]);
+        pixel_get_rgba (stops[k + 1].color, &c1[0], &c1[1], &c1[2], &c1[3]);
+
+        // DDA in 16.16 fixed point: one add per component and pixel, +0.5 for rounding
+        int value[4], step[4];
+
+        for (int c = 0; c < 4; c++)
+        {
+            value[c] = (c0[c] << 16) + 0x8000;
+            step[c]  = ((c1[c] - c0[c]) * 65536) / (i1 - i0);
+        }
+
+        for (int i = i0; i <= i1; i++)
+        {
+            ramp[i] = make_pixel_rgba (value[0] >> 16, value[1] >> 16, value[2] >> 16, value[3] >> 16);
+            for (int c = 0; c < 4; c++) value[c] += step[c];
+        }
+
+    }
+
+    ramp_version = version;
+
+    std::memcpy (out, ramp.data(), length * sizeof (pixel));
+
+}
+
+/* PIXMAP DRAWING */
+
+void Pixmap::draw_gradient (Gradient const &gradient, Rectbox const &rect)
+{
+
+    Rectbox R (rect);
+    if (!clip_rect (&R)) return;
+
+    int const w = R.x2 - R.x1 + 1;
+    int const h = R.y2 - R.y1 + 1;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_GRADIENT, (long long) w * h, (long long) w * h * sizeof (pixel));
+
+    GradientDirection const direction = gradient.direction;
+    bool const blend = with_alpha && !gradient.opaque; // Opaque stops overwrite, whatever the alpha mode
+
+    add_damage (R);
+
+    Pixmap &retained = gradient.retained;
+    bool const retain = gradient.cached && !blend;
+
+    if (retain)
+    {
+        std::lock_guard<std::mutex> lock (gradient.cache_lock); // Another thread may be storing its output
+
+        if (gradient.retained_version == gradient.version && retained.width == w && retained.height == h && retained.format == format)
+        {
+            for_each_band (h, w, [&] (int const band_begin, int const band_end)
+            {
+                for (int y = band_begin; y < band_end; y++)
+                    std::memcpy (datas + (R.y1 + y) * stride + R.x1, retained.datas + y * retained.stride, w * sizeof (pixel));
+            });
+
+            return;
+        }
+    }
+
+    int const length = (direction == GRADIENT_VERTICAL) ? h : (direction == GRADIENT_HORIZONTAL) ? w : w + h - 1;
+
+    std::vector<pixel> ramp (length); // Own copy before the bands, they only read it
+    gradient.copy_ramp (length, ramp.data());
+
+    // Translucent stops into a premultiplied pixmap, blended or copied: the ramp is premultiplied once
+    if (!gradient.opaque && format == PIXEL_PREMULTIPLIED) premultiply_span (ramp.data(), ramp.data(), length);
+
+    // The ramp is now in the pixmap format (opaque stops read the same in both): one kernel for every row
+    BlendMode const mode = blend ? BLEND_OVER : BLEND_COPY;
+    SpanFormat const target = span_format (format);
+
+    for_each_band (h, w, [&] (int const band_begin, int const band_end)
+    {
+        for (int y = band_begin; y < band_end; y++)
+        {
+
+            pixel* const row = datas + (R.y1 + y) * stride + R.x1;
+
+            if (direction == GRADIENT_VERTICAL)
+            {
+                composite_solid (ramp[y], format, row, target, mode, w);
+            }
+            else
+            {
+                // Horizontal: every row is the ramp, diagonal: the ramp shifted by one pixel per row
+                pixel const* const src = ramp.data() + ((direction == GRADIENT_DIAGONAL) ? y : 0);
+
+                composite_span (src, format, row, target, mode, w);
+            }
+
+        }
+    });
+
+    if (retain)
+    {
+        std::lock_guard<std::mutex> lock (gradient.cache_lock);
+
+        retained.resize (w, h, with_alpha);
+        retained.format = format; // Translucent stops are copied premultiplied or not
+
+        for (int y = 0; y < h; y++)
+            std::memcpy (retained.datas + y * retained.stride, datas + (R.y1 + y) * stride + R.x1, w * sizeof (pixel));
+
+        gradient.retained_version = gradient.version;
+    }
+
+}
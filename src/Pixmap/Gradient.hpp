@@ -0,0 +1,75 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __GRADIENT_HPP__
+#define __GRADIENT_HPP__
+
+#include <mutex>
+#include <vector>
+#include "Pixmap.hpp"
+
+/* Linear gradients drawn with 'Pixmap::draw_gradient'. The colours along the gradient axis are
+   computed once into a ramp with fixed-point stepping (kept until the gradient or the length
+   changes), then every row is a solid fill (vertical) or a copy of a window of the ramp
+   (horizontal, diagonal). Blending is skipped when every stop is opaque.
+   In cached mode the last opaque output is retained and copied back while nothing changes.
+   A gradient can be drawn from several threads at once (frame scheduler, tiles, bands): the ramp
+   and the retained output are only touched under 'cache_lock', and callers get their own copy of
+   the ramp. Changing the stops or the direction while it is drawn is not allowed. */
+
+enum GradientDirection {
+    GRADIENT_VERTICAL,   // Top to bottom
+    GRADIENT_HORIZONTAL, // Left to right
+    GRADIENT_DIAGONAL    // Top-left to bottom-right (45°)
+};
+
+struct GradientStop {
+    float position; // 0.0 to 1.0 along the gradient
+    pixel color;
+};
+
+class Gradient {
+
+  private:
+    GradientDirection direction;
+    std::vector<GradientStop> stops; // Sorted by position
+    bool opaque;                     // All stops have alpha 255
+    bool cached;
+
+    unsigned long version;           // Incremented on every change, invalidates the ramp and the retained output
+
+    mutable std::mutex cache_lock;   // Guards the ramp and the retained output below
+    mutable std::vector<pixel> ramp;
+    mutable unsigned long ramp_version;
+
+    mutable Pixmap retained;         // Last opaque output (cached mode)
+    mutable unsigned long retained_version;
+
+    friend class Pixmap;
+    friend class Pipeline; // Gradient stages draw bands of a taller image from the same ramp
+    friend class DrawList; // Copies the ramp of each recorded gradient before drawing
+
+    void copy_ramp (int const length, pixel* const out) const; // The 'length' colours along the axis, copied under the lock
+
+  public:
+    Gradient (GradientDirection const direction, pixel const c_start, pixel const c_end);
+    Gradient (Gradient const &gradient); // Same stops and mode, the caches start empty
+    Gradient& operator= (Gradient const &gradient);
+
+    void add_stop (float const position, pixel const color);
+    void set_direction (GradientDirection const direction);
+    void set_cached (bool const enabled); // Keeps the last opaque output to copy it back next time
+
+    GradientDirection get_direction () const;
+    bool is_opaque () const;
+
+};
+
+#endif
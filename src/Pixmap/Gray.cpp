@@ -0,0 +1,276 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include "Pixmap.hpp"
+#include "Gray.hpp"
+
+#if defined (__x86_64__) || defined (__i386__)
+  #include <immintrin.h>
+  #define PIXMAP_X86
+#endif
+
+#define LUMA_SHIFT 15
+#define LUMA_ROUND (1 << (LUMA_SHIFT - 1))
+
+struct LumaWeights { int r, g, b; };
+
+// Rounded to 15 bits. The BT.601 weights rounded sum to 32769: its blue weight, the one rounded up
+// the most (3735.55), is taken down to 3735. The BT.709 weights rounded already sum to 32768.
+static constexpr LumaWeights luma_weights[] = {
+    { 9798, 19235, 3735 }, // BT.601
+    { 6966, 23436, 2366 }  // BT.709
+};
+
+static_assert (luma_weights[0].r + luma_weights[0].g + luma_weights[0].b == 1 << LUMA_SHIFT, "BT.601 weights must sum to 1.0");
+static_assert (luma_weights[1].r + luma_weights[1].g + luma_weights[1].b == 1 << LUMA_SHIFT, "BT.709 weights must sum to 1.0");
+
+typedef void (*grayscale_span_fn) (pixel const* const src, pixel* const dst, int const n, LumaWeights const w);
+typedef void (*luma_span_fn) (pixel const* const src, uint8_t* const dst, int const n, LumaWeights const w);
+
+/* SCALAR */
+
+static inline uint32_t luma_of (pixel const p, LumaWeights const w)
+{
+    return (w.r * ((p >> 16) & 0xFF) + w.g * ((p >> 8) & 0xFF) + w.b * (p & 0xFF) + LUMA_ROUND) >> LUMA_SHIFT;
+}
+
+static void grayscale_span_scalar (pixel const* const src, pixel* const dst, int const n, LumaWeights const w)
+{
+    for (int i = 0; i < n; i++)
+        dst[i] = (src[i] & 0xFF000000) | (luma_of (src[i], w) * 0x010101);
+}
+
+static void luma_span_scalar (pixel const* const src, uint8_t* const dst, int const n, LumaWeights const w)
+{
+    for (int i = 0; i < n; i++)
+        dst[i] = luma_of (src[i], w);
+}
+
+#ifdef PIXMAP_X86
+
+/* SSE2 */
+
+// Components widened to 16 bits as (B, G, R, A): pmaddwd against (wb, wg, wr, 0) gives B*wb+G*wg
+// and R*wr per pixel, the two halves are then added. The 8-bit weights of pmaddubsw would not
+// keep enough precision (and 0.587 * 256 does not fit a signed byte).
+
+__attribute__ ((target ("sse2")))
+static inline __m128i luma4_sse2 (__m128i const px, __m128i const weights)
+{
+    __m128i const zero = _mm_setzero_si128();
+
+    __m128i lo = _mm_madd_epi16 (_mm_unpacklo_epi8 (px, zero), weights); // bg0 ra0 bg1 ra1
+    __m128i hi = _mm_madd_epi16 (_mm_unpackhi_epi8 (px, zero), weights); // bg2 ra2 bg3 ra3
+
+    lo = _mm_add_epi32 (lo, _mm_shuffle_epi32 (lo, _MM_SHUFFLE (2, 3, 0, 1)));
+    hi = _mm_add_epi32 (hi, _mm_shuffle_epi32 (hi, _MM_SHUFFLE (2, 3, 0, 1)));
+
+    __m128i const sum = _mm_castps_si128 (_mm_shuffle_ps (_mm_castsi128_ps (lo), _mm_castsi128_ps (hi), _MM_SHUFFLE (2, 0, 2, 0)));
+
+    return _mm_srli_epi32 (_mm_add_epi32 (sum, _mm_set1_epi32 (LUMA_ROUND)), LUMA_SHIFT);
+}
+
+__attribute__ ((target ("sse2")))
+static void grayscale_span_sse2 (pixel const* const src, pixel* const dst, int const n, LumaWeights const w)
+{
+    __m128i const weights = _mm_setr_epi16 (w.b, w.g, w.r, 0, w.b, w.g, w.r, 0);
+    __m128i const alpha   = _mm_set1_epi32 ((int) 0xFF000000);
+
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const px = _mm_loadu_si128 ((__m128i const*) (src + i));
+        __m128i const y  = luma4_sse2 (px, weights);
+        __m128i const g  = _mm_or_si128 (_mm_or_si128 (y, _mm_slli_epi32 (y, 8)), _mm_slli_epi32 (y, 16));
+        _mm_storeu_si128 ((__m128i*) (dst + i), _mm_or_si128 (_mm_and_si128 (px, alpha), g));
+    }
+
+    grayscale_span_scalar (src + i, dst + i, n - i, w);
+}
+
+__attribute__ ((target ("sse2")))
+static void luma_span_sse2 (pixel const* const src, uint8_t* const dst, int const n, LumaWeights const w)
+{
+    __m128i const weights = _mm_setr_epi16 (w.b, w.g, w.r, 0, w.b, w.g, w.r, 0);
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i const y0 = luma4_sse2 (_mm_loadu_si128 ((__m128i const*) (src + i)), weights);
+        __m128i const y1 = luma4_sse2 (_mm_loadu_si128 ((__m128i const*) (src + i + 4)), weights);
+        __m128i const y  = _mm_packus_epi16 (_mm_packs_epi32 (y0, y1), _mm_setzero_si128());
+        _mm_storel_epi64 ((__m128i*) (dst + i), y);
+    }
+
+    luma_span_scalar (src + i, dst + i, n - i, w);
+}
+
+/* AVX2 */
+
+// Same as SSE2 on each 128-bit lane: unpack and shuffle_ps never cross lanes, so pixel order is kept
+
+__attribute__ ((target ("avx2")))
+static inline __m256i luma8_avx2 (__m256i const px, __m256i const weights)
+{
+    __m256i const zero = _mm256_setzero_si256();
+
+    __m256i lo = _mm256_madd_epi16 (_mm256_unpacklo_epi8 (px, zero), weights);
+    __m256i hi = _mm256_madd_epi16 (_mm256_unpackhi_epi8 (px, zero), weights);
+
+    lo = _mm256_add_epi32 (lo, _mm256_shuffle_epi32 (lo, _MM_SHUFFLE (2, 3, 0, 1)));
+    hi = _mm256_add_epi32 (hi, _mm256_shuffle_epi32 (hi, _MM_SHUFFLE (2, 3, 0, 1)));
+
+    __m256i const sum = _mm256_castps_si256 (_mm256_shuffle_ps (_mm256_castsi256_ps (lo), _mm256_castsi256_ps (hi), _MM_SHUFFLE (2, 0, 2, 0)));
+
+    return _mm256_srli_epi32 (_mm256_add_epi32 (sum, _mm256_set1_epi32 (LUMA_ROUND)), LUMA_SHIFT);
+}
+
+__attribute__ ((target ("avx2")))
+static void grayscale_span_avx2 (pixel const* const src, pixel* const dst, int const n, LumaWeights const w)
+{
+    __m256i const weights = _mm256_setr_epi16 (w.b, w.g, w.r, 0, w.b, w.g, w.r, 0, w.b, w.g, w.r, 0, w.b, w.g, w.r, 0);
+    __m256i const alpha   = _mm256_set1_epi32 ((int) 0xFF000000);
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const px = _mm256_loadu_si256 ((__m256i const*) (src + i));
+        __m256i const y  = luma8_avx2 (px, weights);
+        __m256i const g  = _mm256_or_si256 (_mm256_or_si256 (y, _mm256_slli_epi32 (y, 8)), _mm256_slli_epi32 (y, 16));
+        _mm256_storeu_si256 ((__m256i*) (dst + i), _mm256_or_si256 (_mm256_and_si256 (px, alpha), g));
+    }
+
+    grayscale_span_sse2 (src + i, dst + i, n - i, w);
+}
+
+__attribute__ ((target ("avx2")))
+static void luma_span_avx2 (pixel const* const src, uint8_t* const dst, int const n, LumaWeights const w)
+{
+    __m256i const weights = _mm256_setr_epi16 (w.b, w.g, w.r, 0, w.b, w.g, w.r, 0, w.b, w.g, w.r, 0, w.b, w.g, w.r, 0);
+
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i const y0 = luma8_avx2 (_mm256_loadu_si256 ((__m256i const*) (src + i)), weights);
+        __m256i const y1 = luma8_avx2 (_mm256_loadu_si256 ((__m256i const*) (src + i + 8)), weights);
+
+        // packs work per lane: (y0.lo y1.lo | y0.hi y1.hi), put back in order before the store
+        __m256i y = _mm256_packs_epi32 (y0, y1);
+        y = _mm256_permute4x64_epi64 (y, _MM_SHUFFLE (3, 1, 2, 0));
+        __m128i const bytes = _mm_packus_epi16 (_mm256_castsi256_si128 (y), _mm256_extracti128_si256 (y, 1));
+        _mm_storeu_si128 ((__m128i*) (dst + i), bytes);
+    }
+
+    luma_span_sse2 (src + i, dst + i, n - i, w);
+}
+
+#endif
+
+/* RUNTIME DISPATCH */
+
+static grayscale_span_fn select_grayscale_span ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return grayscale_span_avx2;
+        if (__builtin_cpu_supports ("sse2")) return grayscale_span_sse2;
+    #endif
+    return grayscale_span_scalar;
+}
+
+static luma_span_fn select_luma_span ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return luma_span_avx2;
+        if (__builtin_cpu_supports ("sse2")) return luma_span_sse2;
+    #endif
+    return luma_span_scalar;
+}
+
+void grayscale_span (pixel const* const src, pixel* const dst, int const n, LumaCoefficients const luma)
+{
+    static grayscale_span_fn const fn = select_grayscale_span();
+    fn (src, dst, n, luma_weights[luma]);
+}
+
+void luma_span (pixel const* const src, uint8_t* const dst, int const n, LumaCoefficients const luma)
+{
+    static luma_span_fn const fn = select_luma_span();
+    fn (src, dst, n, luma_weights[luma]);
+}
+
+/* GRAYMAP */
+
+Graymap::Graymap ()
+{
+    this -> width  = 0;
+    this -> height = 0;
+    this -> stride = 0;
+    this -> datas  = nullptr;
+}
+
+Graymap::Graymap (int const width, int const height) : Graymap ()
+{
+    resize (width, height);
+}
+
+Graymap::~Graymap ()
+{
+    pixels_free ((pixel*) datas);
+}
+
+void Graymap::resize (int const width, int const height)
+{
+    int const new_stride = (width + PIXMAP_ROW_ALIGN - 1) / PIXMAP_ROW_ALIGN * PIXMAP_ROW_ALIGN;
+
+    if ((size_t) new_stride * height > (size_t) stride * this -> height || !datas)
+    {
+        pixels_free ((pixel*) datas);
+        // Allocated in pixels so the rows keep the 64-byte alignment of pixels_alloc
+        datas = (uint8_t*) pixels_alloc ((int) (((size_t) new_stride * height + 3) / 4));
+    }
+
+    this -> width  = width;
+    this -> height = height;
+    this -> stride = new_stride;
+}
+
+int Graymap::get_width  () const { return width; }
+int Graymap::get_height () const { return height; }
+int Graymap::get_stride () const { return stride; }
+
+uint8_t* Graymap::get_row (int const y) const
+{
+    return datas + (size_t) y * stride;
+}
+
+uint8_t Graymap::read_value (int const x, int const y) const
+{
+    if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+    return datas[(size_t) y * stride + x];
+}
+
+/* PIXMAP CONVERSION */
+
+void Pixmap::to_graymap (Graymap &gray, LumaCoefficients const luma) const
+{
+    gray.resize (width, height);
+
+    for_each_band (height, width, [&] (int const y_begin, int const y_end)
+    {
+        for (int y = y_begin; y < y_end; y++)
+            luma_span (datas + y * stride, gray.get_row (y), width, luma);
+    });
+}
@@ -0,0 +1,51 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __GRAY_HPP__
+#define __GRAY_HPP__
+
+#include "Pixmap.hpp"
+
+/* Fixed-point luma: Y = (cr*R + cg*G + cb*B + 2^14) >> 15, the coefficients of each preset
+   summing to 2^15 so white stays 255. SSE2/AVX2 kernels (pmaddwd on 16-bit components) are
+   selected at runtime and give the same result as the scalar code. */
+
+void grayscale_span (pixel const* const src, pixel* const dst, int const n, LumaCoefficients const luma); // Alpha kept
+void luma_span (pixel const* const src, uint8_t* const dst, int const n, LumaCoefficients const luma);
+
+/* 8-bit single-channel image, a quarter of the memory of a Pixmap, for luma-only processing */
+
+class Graymap {
+
+  private:
+    int width;
+    int height;
+    int stride;      // Bytes from one row to the next, multiple of PIXMAP_ROW_ALIGN
+    uint8_t* datas;
+
+  public:
+    Graymap  ();
+    Graymap  (int const width, int const height);
+    Graymap  (Graymap const &) = delete;
+    Graymap& operator= (Graymap const &) = delete;
+    ~Graymap ();
+
+    void resize (int const width, int const height); // Content undefined afterwards
+
+    int get_width  () const;
+    int get_height () const;
+    int get_stride () const;
+
+    uint8_t* get_row (int const y) const;
+    uint8_t read_value (int const x, int const y) const; // 0 when out of the image
+
+};
+
+#endif
@@ -0,0 +1,493 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "ImageIO.hpp"
+#include "Blend.hpp"
+
+#if defined (__unix__) || defined (__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define IMAGE_IO_MMAP
+#endif
+
+/* HEADERS */
+
+static bool read_header_int (FILE* const file, int* const value) // PNM number, comments skipped, eats the following whitespace
+{
+    int c = fgetc (file);
+
+    while (c != EOF)
+    {
+        if (c == '#') { while (c != '\n' && c != EOF) c = fgetc (file); }
+        else if (isspace (c)) c = fgetc (file);
+        else break;
+    }
+
+    if (c == EOF || !isdigit (c)) return false;
+
+    long long v = 0;
+
+    while (c != EOF && isdigit (c))
+    {
+        v = v * 10 + (c - '0');
+        if (v > INT_MAX) return false;
+        c = fgetc (file);
+    }
+
+    *value = (int) v;
+    return true;
+}
+
+static bool read_pam_header (FILE* const file, int* const width, int* const height, int* const depth)
+{
+    char line[256];
+    int maxval = 0;
+
+    *width = *height = *depth = 0;
+
+    while (fgets (line, sizeof (line), file) != nullptr)
+    {
+        char key[32];
+        int value;
+
+        if (line[0] == '#' || sscanf (line, "%31s", key) != 1) continue;
+        if (strcmp (key, "ENDHDR") == 0) return *width > 0 && *height > 0 && *depth >= 1 && *depth <= 4 && maxval == 255;
+        if (strcmp (key, "TUPLTYPE") == 0) continue; // The depth is enough to decode
+
+        if (sscanf (line, "%31s %d", key, &value) != 2) return false;
+
+        if      (strcmp (key, "WIDTH")  == 0) *width  = value;
+        else if (strcmp (key, "HEIGHT") == 0) *height = value;
+        else if (strcmp (key, "DEPTH")  == 0) *depth  = value;
+        else if (strcmp (key, "MAXVAL") == 0) maxval  = value;
+    }
+
+    return false;
+}
+
+/* ROW CONVERSION */
+
+static void decode_row (uint8_t const* src, pixel* const dst, int const width, int const channels, bool const raw)
+{
+
+    if (raw) { std::memcpy (dst, src, width * sizeof (pixel)); return; }
+
+    for (int x = 0; x < width; x++, src += channels)
+    {
+        switch (channels)
+        {
+            case 1:  dst[x] = 0xFF000000 | (src[0] * 0x010101u); break;
+            case 2:  dst[x] = ((pixel) src[1] << 24) | (src[0] * 0x010101u); break;
+            case 3:  dst[x] = make_pixel_rgb (src[0], src[1], src[2]); break;
+            default: dst[x] = make_pixel_rgba (src[0], src[1], src[2], src[3]); break;
+        }
+    }
+
+}
+
+static void encode_row (pixel const* const src, uint8_t* dst, int const width, int const channels, bool const raw)
+{
+
+    if (raw) { std::memcpy (dst, src, width * sizeof (pixel)); return; }
+
+    for (int x = 0; x < width; x++, dst += channels)
+    {
+        pixcmp r,g,b,a;
+        pixel_get_rgba (src[x], &r, &g, &b, &a);
+
+        dst[0] = r; dst[1] = g; dst[2] = b;
+        if (channels == 4) dst[3] = a;
+    }
+
+}
+
+/* READER */
+
+ImageReader::ImageReader ()
+{
+    file = nullptr;
+    format = IMAGE_PPM;
+    width = height = channels = next_row = 0;
+}
+
+ImageReader::~ImageReader ()
+{
+    close();
+}
+
+bool ImageReader::open (char const* const path)
+{
+
+    close();
+
+    file = fopen (path, "rb");
+    if (file == nullptr) return false;
+
+    char magic[2] = {0, 0};
+    bool valid = fread (magic, 1, 2, file) == 2 && magic[0] == 'P';
+    int maxval = 0;
+
+    if (valid && magic[1] == '6')
+    {
+        format = IMAGE_PPM;
+        channels = 3;
+        valid = read_header_int (file, &width) && read_header_int (file, &height) && read_header_int (file, &maxval) && maxval == 255;
+    }
+    else if (valid && magic[1] == '7')
+    {
+        format = IMAGE_PAM;
+        valid = read_pam_header (file, &width, &height, &channels);
+    }
+    else valid = false;
+
+    if (!valid || width <= 0 || height <= 0)
+    {
+
+        #ifdef DEBUG
+            std::cout << "ImageReader::open > '" << path << "' is not a supported PPM / PAM file (8 bits per sample)." << std::endl;
+        #endif
+
+        close();
+        return false;
+
+    }
+
+    next_row = 0;
+    return true;
+
+}
+
+bool ImageReader::open_raw (char const* const path, int const width, int const height)
+{
+
+    close();
+
+    if (width <= 0 || height <= 0) return false;
+
+    file = fopen (path, "rb");
+    if (file == nullptr) return false;
+
+    format = IMAGE_RAW_ARGB;
+    channels = sizeof (pixel);
+    this -> width  = width;
+    this -> height = height;
+    next_row = 0;
+
+    return true;
+
+}
+
+void ImageReader::close ()
+{
+    if (file != nullptr) fclose (file);
+    file = nullptr;
+}
+
+int ImageReader::read_rows (Pixmap &band, int const rows)
+{
+
+    int const n = std::min (rows, height - next_row);
+
+    if (file == nullptr || n <= 0) return 0;
+
+    if (band.get_width() != width || band.get_height() != n) band.resize (width, n, has_alpha());
+
+    size_t const row_bytes = (size_t) width * channels;
+    int const rows_per_chunk = std::max (1, (int) (IMAGE_IO_CHUNK / row_bytes));
+
+    buffer.resize (std::min (n, rows_per_chunk) * row_bytes);
+
+    for (int y = 0; y < n; )
+    {
+
+        int const chunk = std::min (rows_per_chunk, n - y);
+
+        if (fread (buffer.data(), row_bytes, chunk, file) != (size_t) chunk)
+        {
+
+            #ifdef DEBUG
+                std::cout << "ImageReader::read_rows > Truncated file at row " << next_row + y << "." << std::endl;
+            #endif
+
+            next_row = height;
+            return 0;
+
+        }
+
+        for (int r = 0; r < chunk; r++)
+            decode_row (buffer.data() + r * row_bytes, band.get_pixels() + (y + r) * band.get_stride(), width, channels, format == IMAGE_RAW_ARGB);
+
+        y += chunk;
+
+    }
+
+    if (band.get_format() == PIXEL_PREMULTIPLIED)
+        for (int y = 0; y < n; y++)
+            premultiply_span (band.get_pixels() + y * band.get_stride(), band.get_pixels() + y * band.get_stride(), width);
+
+    next_row += n;
+    return n;
+
+}
+
+int ImageReader::get_width    () const { return width; }
+int ImageReader::get_height   () const { return height; }
+int ImageReader::get_next_row () const { return next_row; }
+
+bool ImageReader::has_alpha () const
+{
+    return channels == 2 || channels == 4;
+}
+
+/* WRITER */
+
+ImageWriter::ImageWriter ()
+{
+    file = nullptr;
+    format = IMAGE_PPM;
+    width = height = channels = written_rows = 0;
+    failed = false;
+    used = 0;
+}
+
+ImageWriter::~ImageWriter ()
+{
+    if (file != nullptr) close();
+}
+
+bool ImageWriter::open (char const* const path, ImageFileFormat const format, int const width, int const height, bool const alpha)
+{
+
+    if (file != nullptr) close();
+
+    if (width <= 0 || height <= 0) return false;
+
+    file = fopen (path, "wb");
+    if (file == nullptr) return false;
+
+    this -> format = format;
+    this -> width  = width;
+    this -> height = height;
+    written_rows = 0;
+    failed = false;
+    used = 0;
+
+    switch (format)
+    {
+        case IMAGE_PPM:
+            channels = 3;
+            fprintf (file, "P6\n%d %d\n255\n", width, height);
+            break;
+
+        case IMAGE_PAM:
+            channels = alpha ? 4 : 3;
+            fprintf (file, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n", width, height, channels, alpha ? "RGB_ALPHA" : "RGB");
+            break;
+
+        default:
+            channels = sizeof (pixel);
+            break;
+    }
+
+    buffer.resize (std::max ((size_t) IMAGE_IO_CHUNK, (size_t) width * channels));
+
+    return true;
+
+}
+
+void ImageWriter::flush ()
+{
+    if (used > 0 && fwrite (buffer.data(), 1, used, file) != used) failed = true;
+    used = 0;
+}
+
+bool ImageWriter::write_rows (Pixmap const &band, int const first, int const rows)
+{
+
+    if (file == nullptr || failed) return false;
+
+    if (band.get_width() != width || first < 0 || first + rows > band.get_height() || written_rows + rows > height)
+    {
+        failed = true;
+        return false;
+    }
+
+    size_t const row_bytes = (size_t) width * channels;
+    bool const premultiplied = band.get_format() == PIXEL_PREMULTIPLIED;
+
+    static thread_local std::vector<pixel> straight;
+    if (premultiplied) straight.resize (width);
+
+    for (int y = first; y < first + rows; y++)
+    {
+        if (used + row_bytes > buffer.size()) flush();
+
+        pixel const* row = band.get_pixels() + y * band.get_stride();
+
+        if (premultiplied)
+        {
+            unpremultiply_span (row, straight.data(), width);
+            row = straight.data();
+        }
+
+        encode_row (row, buffer.data() + used, width, channels, format == IMAGE_RAW_ARGB);
+        used += row_bytes;
+    }
+
+    written_rows += rows;
+    return !failed;
+
+}
+
+bool ImageWriter::close ()
+{
+
+    if (file == nullptr) return false;
+
+    flush();
+
+    bool const complete = !failed && written_rows == height;
+    if (fclose (file) != 0) failed = true;
+    file = nullptr;
+
+    #ifdef DEBUG
+        if (!complete) std::cout << "ImageWriter::close > " << written_rows << " / " << height << " rows written." << std::endl;
+    #endif
+
+    return complete && !failed;
+
+}
+
+/* WHOLE IMAGES */
+
+bool load_image (char const* const path, Pixmap &pix)
+{
+    ImageReader reader;
+    return reader.open (path) && reader.read_rows (pix, reader.get_height()) == reader.get_height();
+}
+
+bool load_raw_argb (char const* const path, int const width, int const height, Pixmap &pix)
+{
+    ImageReader reader;
+    return reader.open_raw (path, width, height) && reader.read_rows (pix, height) == height;
+}
+
+bool save_image (char const* const path, Pixmap const &pix, ImageFileFormat const format)
+{
+    ImageWriter writer;
+    if (!writer.open (path, format, pix.get_width(), pix.get_height(), pix.has_alpha())) return false;
+    writer.write_rows (pix, 0, pix.get_height());
+    return writer.close();
+}
+
+/* MAPPED FILES */
+
+MappedImage::MappedImage ()
+{
+    mapping = nullptr;
+    length = 0;
+    pixmap = nullptr;
+}
+
+MappedImage::~MappedImage ()
+{
+    close();
+}
+
+bool MappedImage::open (char const* const path, int const width, int const height, bool const writable)
+{
+
+    close();
+
+    // Pixmap indexes pixels with an int
+    if (width <= 0 || height <= 0 || (long long) width * height > INT_MAX) return false;
+
+    #ifdef IMAGE_IO_MMAP
+
+        size_t const bytes = (size_t) width * height * sizeof (pixel);
+
+        int const fd = ::open (path, writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat (fd, &info) != 0 || (size_t) info.st_size < bytes)
+        {
+
+            #ifdef DEBUG
+                std::cout << "MappedImage::open > '" << path << "' is smaller than " << width << " x " << height << " pixels." << std::endl;
+            #endif
+
+            ::close (fd);
+            return false;
+
+        }
+
+        // Private mappings are copy-on-write: the Pixmap can be modified, the file stays untouched
+        void* const m = mmap (nullptr, bytes, PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        ::close (fd);
+
+        if (m == MAP_FAILED) return false;
+
+        madvise (m, bytes, MADV_SEQUENTIAL); // Band by band processing walks the file forward
+
+        mapping = m;
+        length = bytes;
+        pixmap = new Pixmap ((pixel*) m, width, height, width, true);
+
+        return true;
+
+    #else
+
+        (void) writable; // Changes are not written back without a mapping
+
+        pixmap = new Pixmap();
+        if (load_raw_argb (path, width, height, *pixmap)) return true;
+
+        close();
+        return false;
+
+    #endif
+
+}
+
+void MappedImage::close ()
+{
+
+    delete pixmap;
+    pixmap = nullptr;
+
+    #ifdef IMAGE_IO_MMAP
+        if (mapping != nullptr) munmap (mapping, length);
+    #endif
+
+    mapping = nullptr;
+    length = 0;
+
+}
+
+Pixmap* MappedImage::get_pixmap () const
+{
+    return pixmap;
+}
+
+bool MappedImage::is_valid () const
+{
+    return pixmap != nullptr;
+}
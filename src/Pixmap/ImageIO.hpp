@@ -0,0 +1,119 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __IMAGEIO_HPP__
+#define __IMAGEIO_HPP__
+
+#include <cstdio>
+#include <vector>
+#include "Pixmap.hpp"
+
+#define IMAGE_IO_CHUNK (1024 * 1024) // Bytes moved per fread / fwrite
+
+enum ImageFileFormat {
+    IMAGE_PPM,      // Binary "P6", RGB, maxval 255
+    IMAGE_PAM,      // "P7", depth 1 to 4 (GRAYSCALE, GRAYSCALE_ALPHA, RGB, RGB_ALPHA), maxval 255
+    IMAGE_RAW_ARGB  // Headerless 32-bit pixels as in memory, size given by the caller
+};
+
+/* Files always hold straight (non-premultiplied) colours, premultiplied pixmaps are converted.
+   All functions return false (or 0 rows) on failure, the reason is printed in DEBUG builds. */
+
+bool load_image (char const* const path, Pixmap &pix);                 // PPM or PAM, detected from the header
+bool load_raw_argb (char const* const path, int const width, int const height, Pixmap &pix);
+bool save_image (char const* const path, Pixmap const &pix, ImageFileFormat const format);
+
+/* Sequential reading in bands: only 'rows' rows are in memory at a time */
+
+class ImageReader {
+
+  private:
+    FILE* file;
+    ImageFileFormat format;
+    int width;
+    int height;
+    int channels;      // Bytes per pixel in the file
+    int next_row;
+    std::vector<uint8_t> buffer;
+
+  public:
+    ImageReader  ();
+    ImageReader  (ImageReader const &) = delete;
+    ImageReader& operator= (ImageReader const &) = delete;
+    ~ImageReader ();
+
+    bool open (char const* const path);                                         // PPM or PAM
+    bool open_raw (char const* const path, int const width, int const height); // Raw ARGB
+    void close ();
+
+    int read_rows (Pixmap &band, int const rows); // Next rows into 'band' (resized to width x rows read), 0 at the end
+
+    int get_width () const;
+    int get_height () const;
+    int get_next_row () const;
+    bool has_alpha () const;
+
+};
+
+/* Sequential writing in bands, converted rows are gathered in IMAGE_IO_CHUNK buffers */
+
+class ImageWriter {
+
+  private:
+    FILE* file;
+    ImageFileFormat format;
+    int width;
+    int height;
+    int channels;
+    int written_rows;
+    bool failed;
+    std::vector<uint8_t> buffer;
+    size_t used;
+
+    void flush ();
+
+  public:
+    ImageWriter  ();
+    ImageWriter  (ImageWriter const &) = delete;
+    ImageWriter& operator= (ImageWriter const &) = delete;
+    ~ImageWriter (); // Closes the file if 'close' was not called
+
+    bool open (char const* const path, ImageFileFormat const format, int const width, int const height, bool const alpha); // PPM drops the alpha
+    bool write_rows (Pixmap const &band, int const first, int const rows); // Rows [first, first + rows) of 'band', appended
+    bool close ();  // False if a write failed or rows are missing
+
+};
+
+/* Raw ARGB file mapped in memory and wrapped as a Pixmap: no copy, pages are loaded by the
+   system when touched. Writable mappings write the changes back to the file. Falls back to
+   reading the file into an owned Pixmap where mmap is not available. */
+
+class MappedImage {
+
+  private:
+    void* mapping;
+    size_t length;
+    Pixmap* pixmap;
+
+  public:
+    MappedImage  ();
+    MappedImage  (MappedImage const &) = delete;
+    MappedImage& operator= (MappedImage const &) = delete;
+    ~MappedImage ();
+
+    bool open (char const* const path, int const width, int const height, bool const writable);
+    void close ();
+
+    Pixmap* get_pixmap () const; // nullptr when nothing is open
+    bool is_valid () const;
+
+};
+
+#endif
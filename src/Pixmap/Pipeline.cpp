@@ -0,0 +1,275 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <SDL2/SDL.h>
+#include "Pipeline.hpp"
+#include "Gradient.hpp"
+#include "Composite.hpp"
+#include "ImageIO.hpp"
+#include "Profile.hpp"
+
+Pipeline::Pipeline (int const width, int const height)
+{
+    this -> width  = width;
+    this -> height = height;
+    this -> executor = nullptr;
+    this -> with_alpha = true;
+}
+
+void Pipeline::set_executor (ThreadPool* const pool)
+{
+    executor = pool;
+}
+
+/* STAGES */
+
+void Pipeline::add_stage (PipelineStageType const type)
+{
+    stages.emplace_back();
+
+    PipelineStage &stage = stages.back();
+    stage.type = type;
+    stage.radius = 0;
+    stage.luma = LUMA_BT601;
+    stage.gradient = nullptr;
+    stage.layer = nullptr;
+    stage.first = stage.rows = stage.next_out = 0;
+}
+
+void Pipeline::add_gradient (Gradient const &gradient)
+{
+    add_stage (STAGE_GRADIENT);
+    stages.back().gradient = &gradient;
+}
+
+void Pipeline::add_blur (int const radius)
+{
+    if (radius <= 0) return; // Like 'average_filter', a null radius changes nothing
+
+    add_stage (STAGE_BLUR);
+    stages.back().radius = radius;
+}
+
+void Pipeline::add_grayscale (LumaCoefficients const luma)
+{
+    add_stage (STAGE_GRAYSCALE);
+    stages.back().luma = luma;
+}
+
+void Pipeline::add_blend (Pixmap const &layer)
+{
+    add_stage (STAGE_BLEND);
+    stages.back().layer = &layer;
+}
+
+int Pipeline::get_band_rows () const
+{
+    int const rows = PIPELINE_BAND_BYTES / (pixels_aligned_stride (width) * (int) sizeof (pixel));
+    return std::max (1, std::min (std::max (rows, PIPELINE_MIN_ROWS), height));
+}
+
+/* EXECUTION */
+
+bool Pipeline::push (size_t const index, Pixmap &band, int const y, PipelineSink const &sink)
+{
+
+    if (index == stages.size()) return sink (band, y);
+
+    PipelineStage &stage = stages[index];
+    int const n = band.height;
+
+    switch (stage.type)
+    {
+
+        case STAGE_GRADIENT:
+        {
+            Gradient const &gradient = *stage.gradient;
+            GradientDirection const direction = gradient.direction;
+
+            // The ramp spans the whole image, the band only reads its rows of it
+            int const length = (direction == GRADIENT_VERTICAL) ? height : (direction == GRADIENT_HORIZONTAL) ? width : width + height - 1;
+            std::vector<pixel> ramp (length);
+            gradient.copy_ramp (length, ramp.data());
+            bool const blend = band.with_alpha && !gradient.opaque;
+
+            // Like 'draw_gradient': copied stops are written as they are, blended ones are straight
+            BlendMode const mode = blend ? BLEND_OVER : BLEND_COPY;
+            PixelFormat const ramp_format = blend ? PIXEL_STRAIGHT : band.format;
+
+            for (int i = 0; i < n; i++)
+            {
+                pixel* const row = band.datas + i * band.stride;
+
+                if (direction == GRADIENT_VERTICAL)
+                {
+                    composite_solid (ramp[y + i], ramp_format, row, span_format (band.format), mode, width);
+                }
+                else
+                {
+                    pixel const* const src = ramp.data() + ((direction == GRADIENT_DIAGONAL) ? y + i : 0);
+
+                    composite_span (src, ramp_format, row, span_format (band.format), mode, width);
+                }
+            }
+
+            break;
+        }
+
+        case STAGE_GRAYSCALE:
+            band.grayscale (stage.luma);
+            break;
+
+        case STAGE_BLEND:
+            for (int i = 0; i < n; i++)
+                stage.layer -> blit_line (band, y + i, 0, i);
+            break;
+
+        case STAGE_BLUR:
+        {
+
+            /* 'window' holds image rows [first, first + rows): the rows kept from the previous
+               band followed by the new ones. Row 'r' can be blurred once row r + radius is in
+               (or the image ends), and the window only starts clamping at the image edges, so
+               'box_blur' on it gives the rows of the whole-image blur. */
+
+            int const radius = stage.radius;
+            Pixmap &window = stage.window;
+
+            for (int i = 0; i < n; i++)
+                std::memcpy (window.datas + (stage.rows + i) * window.stride, band.datas + i * band.stride, width * sizeof (pixel));
+
+            stage.rows += n;
+
+            int const window_end = stage.first + stage.rows;
+            int const ready_end  = (window_end == height) ? height : window_end - radius;
+
+            if (ready_end <= stage.next_out) return true; // First bands of a large radius: nothing complete yet
+
+            Pixmap src (window.datas, width, stage.rows, window.stride, with_alpha);
+            Pixmap dst (stage.blurred.datas, width, stage.rows, stage.blurred.stride, with_alpha);
+            dst.executor = executor;
+
+            int const out_begin = stage.next_out - stage.first;
+            int const out_count = ready_end - stage.next_out;
+
+            dst.for_each_band (out_count, width, [&] (int const b, int const e)
+            {
+                dst.box_blur (src, radius, out_begin + b, out_begin + e);
+            });
+
+            int const out_y = stage.next_out;
+            stage.next_out = ready_end;
+
+            // Only the rows the next outputs still read are kept, moved to the top of the window
+            int const drop = std::max (stage.next_out - radius, stage.first) - stage.first;
+
+            if (drop > 0)
+            {
+                std::memmove (window.datas, window.datas + drop * window.stride, (size_t) (stage.rows - drop) * window.stride * sizeof (pixel));
+                stage.first += drop;
+                stage.rows  -= drop;
+            }
+
+            Pixmap out (stage.blurred.datas + out_begin * stage.blurred.stride, width, out_count, stage.blurred.stride, with_alpha);
+            out.executor = executor;
+
+            return push (index + 1, out, out_y, sink);
+
+        }
+
+    }
+
+    return push (index + 1, band, y, sink);
+
+}
+
+bool Pipeline::run (PipelineSource const &source, PipelineSink const &sink)
+{
+
+    if (width <= 0 || height <= 0) return false;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_PIPELINE, (long long) width * height, (long long) width * height * sizeof (pixel));
+
+    int const band_rows = get_band_rows();
+
+    // A blur emits up to 'radius' rows more than it gets (last band), the next ones must hold them
+    int extra_rows = 0;
+
+    for (PipelineStage &stage : stages)
+    {
+        stage.first = stage.rows = stage.next_out = 0;
+
+        if (stage.type != STAGE_BLUR) continue;
+
+        int const capacity = band_rows + extra_rows + 2 * stage.radius;
+        stage.window.resize  (width, capacity, true);
+        stage.blurred.resize (width, capacity, true);
+
+        extra_rows += stage.radius;
+    }
+
+    Pixmap band (width, band_rows);
+
+    for (int y = 0; y < height; y += band_rows)
+    {
+        Pixmap rows (band.datas, width, std::min (band_rows, height - y), band.stride, with_alpha);
+        rows.executor = executor;
+
+        if (source && !source (rows, y)) return false;
+        if (!push (0, rows, y, sink)) return false;
+    }
+
+    return true;
+
+}
+
+bool Pipeline::run (Pixmap const &src, Pixmap &dst)
+{
+
+    if (&src == &dst || src.width != width || src.height != height) return false;
+
+    if (dst.width != width || dst.height != height) dst.resize (width, height, src.with_alpha);
+
+    with_alpha = src.with_alpha;
+
+    return run ([&] (Pixmap &band, int const y)
+    {
+        for (int i = 0; i < band.height; i++)
+            std::memcpy (band.datas + i * band.stride, src.datas + (y + i) * src.stride, width * sizeof (pixel));
+        return true;
+    },
+    [&] (Pixmap const &band, int const y)
+    {
+        for (int i = 0; i < band.height; i++)
+            std::memcpy (dst.datas + (y + i) * dst.stride, band.datas + i * band.stride, width * sizeof (pixel));
+        return true;
+    });
+
+}
+
+bool Pipeline::run (ImageReader &reader, ImageWriter &writer)
+{
+
+    if (reader.get_width() != width || reader.get_height() != height) return false;
+
+    with_alpha = reader.has_alpha();
+
+    return run ([&] (Pixmap &band, int const)
+    {
+        return reader.read_rows (band, band.height) == band.height;
+    },
+    [&] (Pixmap const &band, int const)
+    {
+        return writer.write_rows (band, 0, band.height);
+    });
+
+}
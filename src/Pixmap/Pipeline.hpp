@@ -0,0 +1,89 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __PIPELINE_HPP__
+#define __PIPELINE_HPP__
+
+#include <functional>
+#include <vector>
+#include "Pixmap.hpp"
+
+#define PIPELINE_BAND_BYTES (256 * 1024) // One band of every stage stays in L2 while it goes down the chain
+#define PIPELINE_MIN_ROWS   8
+
+/* Chain of operations run band by band over an image that never has to be in memory as a
+   whole: each band of rows comes from a source, goes through every stage while it is hot in
+   cache, and is handed to a sink. Point stages work in place on the band. A blur stage keeps
+   the 2 * radius rows it needs from the previous band and emits its rows 'radius' rows late,
+   with the same result as 'average_filter' on the whole image.
+   Memory: one band, plus (band + 2 * radius) rows twice per blur stage. */
+
+class Gradient;
+class ThreadPool;
+class ImageReader;
+class ImageWriter;
+
+enum PipelineStageType {
+    STAGE_GRADIENT,  // Draws the gradient over the image (blended when it has translucent stops)
+    STAGE_BLUR,      // Box blur of 'average_filter'
+    STAGE_GRAYSCALE,
+    STAGE_BLEND      // Blends a layer of the image size over it
+};
+
+typedef std::function<bool (Pixmap &band, int const y)> PipelineSource;      // Fills every row of 'band' (image rows from 'y'), false to stop
+typedef std::function<bool (Pixmap const &band, int const y)> PipelineSink;  // Receives finished rows in order, false to stop
+
+struct PipelineStage {
+
+  PipelineStageType type;
+  int radius;
+  LumaCoefficients luma;
+  Gradient const* gradient;
+  Pixmap const* layer;
+
+  Pixmap window;   // Blur: input rows [first, first + rows) of the image
+  Pixmap blurred;  // Blur: output rows, same layout as 'window'
+  int first;
+  int rows;
+  int next_out;    // Next image row the stage will emit
+
+};
+
+class Pipeline {
+
+  private:
+    int width;
+    int height;
+    std::vector<PipelineStage> stages;
+    ThreadPool* executor;
+    bool with_alpha;       // Of the bands, taken from the source of 'run'
+
+    void add_stage (PipelineStageType const type);
+    bool push (size_t const index, Pixmap &band, int const y, PipelineSink const &sink); // Through stage 'index' and the next ones
+
+  public:
+    Pipeline (int const width, int const height);
+
+    void set_executor (ThreadPool* const pool); // Rows of each band split on 'pool'
+
+    void add_gradient (Gradient const &gradient); // Kept by reference until 'run' returns
+    void add_blur (int const radius);
+    void add_grayscale (LumaCoefficients const luma);
+    void add_blend (Pixmap const &layer);         // Same size as the image, kept by reference
+
+    int get_band_rows () const;
+
+    bool run (PipelineSource const &source, PipelineSink const &sink); // Empty source: bands start undefined (chains starting with a gradient)
+    bool run (Pixmap const &src, Pixmap &dst);                         // 'dst' resized, may not be 'src'
+    bool run (ImageReader &reader, ImageWriter &writer);               // File to file, the image is never loaded whole
+
+};
+
+#endif
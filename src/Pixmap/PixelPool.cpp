@@ -0,0 +1,75 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <SDL2/SDL.h>
+#include "PixelPool.hpp"
+
+PixelPool::PixelPool ()
+{
+}
+
+PixelPool::~PixelPool ()
+{
+    trim();
+}
+
+pixel* PixelPool::acquire (int const count, int* const capacity)
+{
+
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+
+        int best = -1;
+
+        for (int i = 0; i < (int) free_blocks.size(); i++)
+        {
+            int const c = free_blocks[i].capacity;
+            if (c >= count && (best < 0 || c < free_blocks[best].capacity)) best = i;
+        }
+
+        if (best >= 0)
+        {
+            Block const block = free_blocks[best];
+            free_blocks[best] = free_blocks.back();
+            free_blocks.pop_back();
+
+            *capacity = block.capacity;
+            return block.buffer;
+        }
+    }
+
+    *capacity = count;
+    return pixels_alloc (count);
+
+}
+
+void PixelPool::release (pixel* const buffer, int const capacity)
+{
+    if (buffer == nullptr) return;
+
+    std::lock_guard<std::mutex> lock (mutex);
+    free_blocks.push_back ({buffer, capacity});
+}
+
+void PixelPool::trim ()
+{
+    std::lock_guard<std::mutex> lock (mutex);
+
+    for (Block const &block : free_blocks)
+        pixels_free (block.buffer);
+
+    free_blocks.clear();
+}
+
+int PixelPool::get_free_count () const
+{
+    std::lock_guard<std::mutex> lock (mutex);
+    return (int) free_blocks.size();
+}
@@ -0,0 +1,48 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __PIXELPOOL_HPP__
+#define __PIXELPOOL_HPP__
+
+#include <mutex>
+#include <vector>
+#include "Pixmap.hpp"
+
+/* Keeps released pixel buffers so that pixmaps recreated every frame (temporaries, blur copies...)
+   reuse the same memory instead of going back to the allocator. Thread-safe. */
+
+class PixelPool {
+
+  private:
+    struct Block {
+        pixel* buffer;
+        int capacity; // In pixels
+    };
+
+    std::vector<Block> free_blocks;
+    mutable std::mutex mutex;
+
+  public:
+    PixelPool  ();
+    ~PixelPool ();
+
+    PixelPool (PixelPool const &) = delete;
+    PixelPool& operator= (PixelPool const &) = delete;
+
+    pixel* acquire (int const count, int* const capacity);    // Smallest free buffer holding 'count' pixels, or a new one
+    void release (pixel* const buffer, int const capacity);   // Gives the buffer back to the pool (takes ownership)
+
+    void trim (); // Frees every buffer waiting for reuse
+
+    int get_free_count () const;
+
+};
+
+#endif
@@ -9,8 +9,24 @@
 */
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
 #include <SDL2/SDL.h>
 #include "Pixmap.hpp"
+#include "Blend.hpp"
+#include "Composite.hpp"
+#include "ThreadPool.hpp"
+#include "PixelPool.hpp"
+#include "Gradient.hpp"
+#include "Fill.hpp"
+#include "Gray.hpp"
+#include "Profile.hpp"
+
+#define PARALLEL_MIN_PIXELS (256 * 256) // Below this, waking the workers costs more than the operation
+#define BAND_MIN_BYTES      (64 * 1024) // Large bands amortize the dispatch; rows are cache-line aligned so bands never share a line
+#define BANDS_PER_THREAD    4           // A few bands per thread to absorb uneven scheduling
 
 /* VARIOUS MATHEMATICAL TOOLS */
 
@@ -20,6 +36,29 @@ void int_restrict (int* const value, int const vmin, int const vmax)
     if (*value > vmax) *value = vmax;
 }
 
+void pixel_out_of_limit (char const* const function, int const x, int const y)
+{
+    std::cout << function << " > Pixel ' " << x << " : " << y << " ' is out of limit." << std::endl;
+}
+
+/* ALIGNED PIXEL BUFFERS */
+
+pixel* pixels_alloc (int const count)
+{
+    return (pixel*) ::operator new[] (count * sizeof (pixel), std::align_val_t (PIXMAP_ROW_ALIGN));
+}
+
+void pixels_free (pixel* const buffer)
+{
+    if (buffer != nullptr) ::operator delete[] (buffer, std::align_val_t (PIXMAP_ROW_ALIGN));
+}
+
+int pixels_aligned_stride (int const width)
+{
+    int const per_line = PIXMAP_ROW_ALIGN / sizeof (pixel);
+    return (width + per_line - 1) / per_line * per_line;
+}
+
 /* RECTBOX STRUCTURE */
 
 void Rectbox::setter (int const x1, int const y1, int const x2, int const y2)
@@ -43,6 +82,12 @@ Rectbox::Rectbox (Rectbox const &r)
     y2 = r.y2;
 }
 
+Rectbox& Rectbox::operator= (Rectbox const &r)
+{
+    this -> setter (r.x1, r.y1, r.x2, r.y2);
+    return *this;
+}
+
 Rectbox::Rectbox (int const x1, int const y1, int const x2, int const y2)
 {
     this -> setter (x1, y1, x2, y2);
@@ -55,16 +100,62 @@ Pixmap::Pixmap ()
 {
     width  = -1;
     height = -1;
+    stride = 0;
     datas  = nullptr;
+    capacity = 0;
+    owns_datas = true;
     with_alpha = false;
+    format = PIXEL_STRAIGHT;
+    executor = nullptr;
+    pool = nullptr;
+    track_damage = false;
+}
+
+void Pixmap::allocate (int const count)
+{
+    if (pool != nullptr) datas = pool -> acquire (count, &capacity);
+    else { datas = pixels_alloc (count); capacity = count; }
+
+    owns_datas = true;
+}
+
+void Pixmap::release ()
+{
+    if (owns_datas)
+    {
+        if (pool != nullptr) pool -> release (datas, capacity);
+        else pixels_free (datas);
+    }
+
+    datas = nullptr;
+    capacity = 0;
+    owns_datas = true;
+}
+
+void Pixmap::copy_rows (Pixmap const &pix)
+{
+    if (stride == pix.stride && height > 0)
+    {
+        // Stops at the end of the last row: the source may be a view, whose padding is its parent's next pixels
+        std::memcpy (datas, pix.datas, (stride * (height - 1) + width) * sizeof (pixel));
+        return;
+    }
+
+    for (int y = 0; y < height; y++)
+        std::memcpy (datas + y * stride, pix.datas + y * pix.stride, width * sizeof (pixel));
 }
 
 void Pixmap::init (int const width, int const height, bool const alpha)
 {
     this -> width  = width;
     this -> height = height;
-    this -> datas  = new pixel[width*height];
+    this -> stride = pixels_aligned_stride (width);
     this -> with_alpha = alpha;
+    this -> format = PIXEL_STRAIGHT;
+    this -> executor = nullptr;
+    this -> pool = nullptr;
+    this -> track_damage = false;
+    allocate (stride * height);
 }
 
 Pixmap::Pixmap (int const width, int const height)
@@ -78,14 +169,70 @@ Pixmap::Pixmap (int const width, int const height, int const background_color, b
     fill (background_color);
 }
 
+Pixmap::Pixmap (int const width, int const height, bool const alpha, PixelPool* const pool)
+{
+    this -> width  = width;
+    this -> height = height;
+    this -> stride = pixels_aligned_stride (width);
+    this -> with_alpha = alpha;
+    this -> format = PIXEL_STRAIGHT;
+    this -> executor = nullptr;
+    this -> pool = pool;
+    this -> track_damage = false;
+    allocate (stride * height);
+}
+
+Pixmap::Pixmap (pixel* const buffer, int const width, int const height, int const stride, bool const alpha)
+{
+    this -> width  = width;
+    this -> height = height;
+    this -> stride = stride;
+    this -> datas  = buffer;
+    this -> capacity = stride * height;
+    this -> owns_datas = false;
+    this -> with_alpha = alpha;
+    this -> format = PIXEL_STRAIGHT;
+    this -> executor = nullptr;
+    this -> pool = nullptr;
+    this -> track_damage = false;
+}
+
 Pixmap::Pixmap (Pixmap const &pix) // Re-copy constructor
 {
     width  = pix.width;
     height = pix.height;
+    stride = pixels_aligned_stride (width); // A copy of a wrapped buffer is owned and aligned
     with_alpha  = pix.with_alpha;
-    datas  = new pixel [width*height];
-    for (int i = 0; i < width * height; i++)
-      datas[i] = pix.datas[i];
+    format = pix.format;
+    executor = pix.executor;
+    pool = pix.pool;
+    track_damage = pix.track_damage;
+    allocate (stride * height);
+    copy_rows (pix);
+
+    if (track_damage) add_damage (Rectbox (0, 0, width - 1, height - 1)); // Nothing of the copy was uploaded yet, like 'set_damage_tracking'
+}
+
+Pixmap::Pixmap (Pixmap &&pix) noexcept // Move constructor
+{
+    width  = pix.width;
+    height = pix.height;
+    stride = pix.stride;
+    datas  = pix.datas;
+    capacity = pix.capacity;
+    owns_datas = pix.owns_datas;
+    with_alpha = pix.with_alpha;
+    format = pix.format;
+    executor = pix.executor;
+    pool = pix.pool;
+    track_damage = pix.track_damage;
+    damage = std::move (pix.damage);
+
+    pix.width = pix.height = -1;
+    pix.stride = 0;
+    pix.datas = nullptr;
+    pix.capacity = 0;
+    pix.owns_datas = true;
 }
 
 Pixmap::~Pixmap ()
@@ -95,54 +242,417 @@ Pixmap::~Pixmap ()
         std::cout << "Destructor of pixmap ( " << width << " x " << height << " ) is called." << std::endl;
     #endif
 
-    delete[] datas;
+    release();
 
 }
 
-void Pixmap::blit_on_texture_centered (SDL_Texture* const texture, const int texture_w, const int texture_h) const
+Pixmap& Pixmap::operator= (Pixmap const &pix)
 {
-    int x1 = (texture_w - width)  / 2;
-    int y1 = (texture_h - height) / 2;
-    blit_on_texture (texture, x1, y1);
+
+    if (this == &pix) return *this;
+
+    resize (pix.width, pix.height, pix.with_alpha);
+    format = pix.format;
+    if (datas != nullptr) copy_rows (pix);
+
+    if (track_damage) add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+    return *this;
+
 }
 
-void Pixmap::blit_on_texture (SDL_Texture* const texture, int const x1, int const y1) const
+Pixmap& Pixmap::operator= (Pixmap &&pix) noexcept
 {
-    SDL_Rect rect = {x1, y1, width, height};
-    SDL_UpdateTexture (texture, &rect, datas, width * sizeof (Uint32));
+
+    if (this == &pix) return *this;
+
+    release();
+
+    width  = pix.width;
+    height = pix.height;
+    stride = pix.stride;
+    datas  = pix.datas;
+    capacity = pix.capacity;
+    owns_datas = pix.owns_datas;
+    with_alpha = pix.with_alpha;
+    format = pix.format;
+    executor = pix.executor; // Like the move constructor: the moved pixmap is taken whole
+    pool = pix.pool; // The buffer goes back to the pool it came from
+    track_damage = pix.track_damage;
+    damage = std::move (pix.damage);
+
+    pix.width = pix.height = -1;
+    pix.stride = 0;
+    pix.datas = nullptr;
+    pix.capacity = 0;
+    pix.owns_datas = true;
+
+    return *this;
+
 }
 
-void Pixmap::blit_line (Pixmap const &pix, int const line_number, int const x1, int const y1) const
+void Pixmap::resize (int const width, int const height, bool const alpha)
 {
 
-    pixel* src_ptr    = datas + line_number * width;
-    pixel* target_ptr = pix.datas + y1 * pix.width + x1;
+    // A wrapped buffer keeps the caller's layout: it is reused only while the new rows fit its rows,
+    // otherwise the pixmap detaches to an owned buffer rather than laying them out in foreign memory
+    bool const keep_wrap = !owns_datas && width <= stride && stride * height <= capacity;
 
-    if (!with_alpha)
+    int const new_stride = keep_wrap ? stride : pixels_aligned_stride (width);
+    int const count = (width > 0 && height > 0) ? new_stride * height : 0;
+
+    if (!keep_wrap && (!owns_datas || count > capacity))
     {
-        for (int x = 0; x < width; x++, src_ptr++, target_ptr++)
-            *target_ptr = *src_ptr;
+        release();
+        allocate (count);
     }
+
+    this -> stride = new_stride;
+    this -> width  = width;
+    this -> height = height;
+    this -> with_alpha = alpha;
+
+    damage.clear();
+    if (track_damage) add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+}
+
+void Pixmap::set_pool (PixelPool* const pool)
+{
+    this -> pool = pool; // Buffers come from 'pixels_alloc' in both cases, so the current one can be given to 'pool' later
+}
+
+void Pixmap::set_executor (ThreadPool* const pool)
+{
+    executor = pool;
+}
+
+void Pixmap::set_format (PixelFormat const format)
+{
+
+    if (format == this -> format) return;
+
+    this -> format = format;
+
+    if (datas == nullptr) return;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_SET_FORMAT, (long long) width * height, (long long) width * height * sizeof (pixel));
+
+    add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+    for_each_band (height, width, [&] (int const y_begin, int const y_end)
+    {
+        for (int y = y_begin; y < y_end; y++)
+        {
+            if (format == PIXEL_PREMULTIPLIED) premultiply_span (datas + y * stride, datas + y * stride, width);
+            else                               unpremultiply_span (datas + y * stride, datas + y * stride, width);
+        }
+    });
+
+}
+
+PixelFormat Pixmap::get_format () const
+{
+    return format;
+}
+
+int Pixmap::band_count (int const rows, int const span_width) const
+{
+
+    if (executor == nullptr || executor -> get_thread_count() < 2 || span_width <= 0 || (long long) span_width * rows < PARALLEL_MIN_PIXELS) return 1;
+
+    int const row_bytes = span_width * (int) sizeof (pixel); // Bytes a band really touches per row
+    int const band_min_rows = (BAND_MIN_BYTES + row_bytes - 1) / row_bytes;
+
+    int bands = executor -> get_thread_count() * BANDS_PER_THREAD;
+    if (bands > rows / band_min_rows) bands = rows / band_min_rows;
+
+    return std::max (bands, 1);
+
+}
+
+void Pixmap::for_each_band (int const rows, int const span_width, std::function<void (int, int)> const &job) const
+{
+
+    if (rows <= 0) return;
+
+    int const bands = band_count (rows, span_width);
+
+    if (bands == 1)
+    {
+        job (0, rows);
+        return;
+    }
+
+    // Every row is computed independently of the band it falls in, so the output is deterministic
+    #ifdef PIXMAP_PROFILE
+        executor -> parallel_for (rows, bands, [&] (int const band_begin, int const band_end)
+        {
+            PIXMAP_PROFILE_SCOPE (PROFILE_BAND, (long long) span_width * (band_end - band_begin), 0);
+            job (band_begin, band_end);
+        });
+    #else
+        executor -> parallel_for (rows, bands, job);
+    #endif
+
+}
+
+/* DAMAGE TRACKING */
+
+bool Pixmap::clip_rect (Rectbox* const rect) const
+{
+    if (rect -> x2 < 0 || rect -> y2 < 0 || rect -> x1 >= width || rect -> y1 >= height) return false;
+    if (rect -> x1 > rect -> x2 || rect -> y1 > rect -> y2) return false;
+
+    int_restrict (&rect -> x1, 0, width  - 1);
+    int_restrict (&rect -> y1, 0, height - 1);
+    int_restrict (&rect -> x2, 0, width  - 1);
+    int_restrict (&rect -> y2, 0, height - 1);
+
+    return true;
+}
+
+static bool rects_touch (Rectbox const &a, Rectbox const &b) // Overlapping or edge-adjacent
+{
+    return a.x1 <= b.x2 + 1 && b.x1 <= a.x2 + 1 && a.y1 <= b.y2 + 1 && b.y1 <= a.y2 + 1;
+}
+
+static void rect_union (Rectbox* const a, Rectbox const &b)
+{
+    a -> setter (std::min (a -> x1, b.x1), std::min (a -> y1, b.y1), std::max (a -> x2, b.x2), std::max (a -> y2, b.y2));
+}
+
+void Pixmap::add_damage (Rectbox const &rect)
+{
+
+    if (!track_damage) return;
+
+    Rectbox r (rect);
+    if (!clip_rect (&r)) return;
+
+    // Consecutive writes (rows of a blit, neighbour pixels...) usually extend the previous rect
+    if (!damage.empty() && rects_touch (damage.back(), r))
+        rect_union (&damage.back(), r);
     else
+        damage.push_back (r);
+
+}
+
+void Pixmap::set_damage_tracking (bool const enabled)
+{
+    track_damage = enabled;
+    damage.clear();
+
+    if (enabled) add_damage (Rectbox (0, 0, width - 1, height - 1));
+}
+
+std::vector<Rectbox> const& Pixmap::get_damage () const
+{
+    return damage;
+}
+
+Rectbox Pixmap::get_damage_bounds () const
+{
+    if (damage.empty()) return Rectbox();
+
+    Rectbox bounds (damage[0]);
+    for (Rectbox const &r : damage) rect_union (&bounds, r);
+
+    return bounds;
+}
+
+void Pixmap::merge_damage ()
+{
+
+    bool merged = true;
+
+    while (merged) // A union can touch rects that were apart before, so repeat until stable
     {
-        for (int x = 0; x < width; x++, src_ptr++, target_ptr++)
-            pixel_put_alpha (*src_ptr, target_ptr);
+        merged = false;
+
+        for (size_t i = 0; i < damage.size(); i++)
+        {
+            for (size_t j = i + 1; j < damage.size(); )
+            {
+                if (rects_touch (damage[i], damage[j]))
+                {
+                    rect_union (&damage[i], damage[j]);
+                    damage[j] = damage.back();
+                    damage.pop_back();
+                    merged = true;
+                }
+                else j++;
+            }
+        }
     }
 
 }
 
-void Pixmap::draw_rect (Rectbox const &rect, pixel const color)
+void Pixmap::clear_damage ()
 {
-    for (int y = rect.y1; y <= rect.y2; y++)
+    damage.clear();
+}
+
+void Pixmap::restore (Pixmap const &layer, Rectbox const &rect)
+{
+
+    Rectbox r (rect);
+    if (!clip_rect (&r) || layer.width != width || layer.height != height) return;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_RESTORE, (long long) (r.x2 - r.x1 + 1) * (r.y2 - r.y1 + 1), (long long) (r.x2 - r.x1 + 1) * (r.y2 - r.y1 + 1) * sizeof (pixel));
+
+    for (int y = r.y1; y <= r.y2; y++)
+        std::memcpy (datas + y * stride + r.x1, layer.datas + y * layer.stride + r.x1, (r.x2 - r.x1 + 1) * sizeof (pixel));
+
+    add_damage (r);
+
+}
+
+void Pixmap::blit_on_texture_centered (SDL_Texture* const texture, const int texture_w, const int texture_h) const
+{
+    int x1 = (texture_w - width)  / 2;
+    int y1 = (texture_h - height) / 2;
+    blit_on_texture (texture, x1, y1);
+}
+
+void Pixmap::blit_on_texture (SDL_Texture* const texture, int const x1, int const y1) const
+{
+
+    // SDL textures hold straight ARGB: premultiplied pixmaps go through a converted copy of each rect
+    static thread_local std::vector<pixel> converted;
+
+    auto const upload = [&] (Rectbox const &r)
     {
-        for (int x = rect.x1; x <= rect.x2; x++)
+        SDL_Rect rect = {x1 + r.x1, y1 + r.y1, r.x2 - r.x1 + 1, r.y2 - r.y1 + 1};
+        PIXMAP_PROFILE_SCOPE (PROFILE_BLIT_TEXTURE, (long long) rect.w * rect.h, (long long) rect.w * rect.h * sizeof (pixel));
+
+        if (format != PIXEL_PREMULTIPLIED)
         {
-            datas[y * width + x] = color;
+            SDL_UpdateTexture (texture, &rect, datas + r.y1 * stride + r.x1, stride * sizeof (Uint32));
+            return;
         }
+
+        converted.resize ((size_t) rect.w * rect.h);
+
+        for (int y = 0; y < rect.h; y++)
+            unpremultiply_span (datas + (r.y1 + y) * stride + r.x1, converted.data() + y * rect.w, rect.w);
+
+        SDL_UpdateTexture (texture, &rect, converted.data(), rect.w * sizeof (Uint32));
+    };
+
+    if (!track_damage)
+    {
+        if (datas != nullptr && width > 0 && height > 0) upload (Rectbox (0, 0, width - 1, height - 1));
+        return;
     }
+
+    for (Rectbox const &r : damage)
+        upload (r);
+
+}
+
+void Pixmap::blit_line (Pixmap &pix, int const line_number, int const x1, int const y1) const
+{
+    blit_line (pix, line_number, x1, y1, with_alpha ? BLEND_OVER : BLEND_COPY);
+}
+
+void Pixmap::blit_line (Pixmap &pix, int const line_number, int const x1, int const y1, BlendMode const mode) const
+{
+
+    if (line_number < 0 || line_number >= height || y1 < 0 || y1 >= pix.height) return;
+
+    // Clipped once for the whole row: source pixels [begin, end) land inside 'pix'
+    int const begin = std::max (0, -x1);
+    int const end   = std::min (width, pix.width - x1);
+
+    if (begin >= end) return;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_BLIT_LINE, end - begin, (end - begin) * sizeof (pixel));
+
+    pix.add_damage (Rectbox (x1 + begin, y1, x1 + end - 1, y1));
+
+    pixel const* src_ptr = datas + line_number * stride + begin;
+    pixel* target_ptr    = pix.datas + y1 * pix.stride + x1 + begin;
+
+    // Opaque pixels read the same in both formats: they are taken as they are
+    PixelFormat const src_format = with_alpha ? format : pix.format;
+
+    composite_span (src_ptr, src_format, target_ptr, span_format (pix.format), mode, end - begin);
+
+}
+
+void Pixmap::blit_line_subpixel (Pixmap &pix, int const line_number, int64_t const x1_fx, int const y1) const
+{
+
+    int const frac = (int) (x1_fx >> 8) & 0xFF; // Weight of the left neighbour, 8 bits
+    int const x1   = (int) (x1_fx >> 16);       // Floor, also for negative positions
+
+    if (frac == 0) { blit_line (pix, line_number, x1, y1); return; }
+
+    if (line_number < 0 || line_number >= height || y1 < 0 || y1 >= pix.height || width <= 0) return;
+
+    // The shifted row covers width + 1 target pixels
+    int const begin = std::max (0, -x1);
+    int const end   = std::min (width + 1, pix.width - x1);
+
+    if (begin >= end) return;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_BLIT_LINE, end - begin, (end - begin) * sizeof (pixel));
+
+    static thread_local std::vector<pixel> row;
+    row.resize (width + 1);
+
+    pixel const* src_ptr = datas + line_number * stride;
+
+    for (int j = begin; j < end; j++)
+    {
+        pixcmp r,g,b,a;
+
+        if (j == 0 || j == width) // Edges: colour of the only source pixel, alpha by coverage
+        {
+            int const cover = (j == 0) ? 256 - frac : frac;
+            pixel_get_rgba (src_ptr[j == 0 ? 0 : width - 1], &r, &g, &b, &a);
+
+            if (format == PIXEL_PREMULTIPLIED) // The colour scales with the alpha
+                row[j] = make_pixel_rgba ((r * cover + 128) >> 8, (g * cover + 128) >> 8, (b * cover + 128) >> 8, (a * cover + 128) >> 8);
+            else
+                row[j] = make_pixel_rgba (r, g, b, (a * cover + 128) >> 8);
+
+            continue;
+        }
+
+        pixcmp rr,gg,bb,aa;
+        pixel_get_rgba (src_ptr[j - 1], &r, &g, &b, &a);
+        pixel_get_rgba (src_ptr[j], &rr, &gg, &bb, &aa);
+
+        row[j] = make_pixel_rgba ((r * frac + rr * (256 - frac) + 128) >> 8, (g * frac + gg * (256 - frac) + 128) >> 8,
+                                  (b * frac + bb * (256 - frac) + 128) >> 8, (a * frac + aa * (256 - frac) + 128) >> 8);
+    }
+
+    pix.add_damage (Rectbox (x1 + begin, y1, x1 + end - 1, y1));
+
+    // Opaque interior pixels come out as plain copies of the blend, only the edges really mix
+    // Premultiplied sources interpolate without dark fringes where the alpha changes
+    composite_span (row.data() + begin, format, pix.datas + y1 * pix.stride + x1 + begin, span_format (pix.format), BLEND_OVER, end - begin);
+
+}
+
+void Pixmap::draw_rect (Rectbox const &rect, pixel const color)
+{
+    add_damage (rect);
+
+    pixel const value = (format == PIXEL_PREMULTIPLIED) ? pixel_premultiply (color) : color; // Like 'fill'
+
+    for (int y = rect.y1; y <= rect.y2; y++)
+        fill_span (datas + y * stride + rect.x1, value, rect.x2 - rect.x1 + 1);
 }
 
 void Pixmap::draw_rectbox (Rectbox const &rect, pixel const color)
+{
+    draw_rectbox (rect, color, 255);
+}
+
+void Pixmap::draw_rectbox (Rectbox const &rect, pixel const color, pixcmp const coverage)
 {
 
     Rectbox r (rect.x1, rect.y1, rect.x2, rect.y2);
@@ -163,195 +673,269 @@ void Pixmap::draw_rectbox (Rectbox const &rect, pixel const color)
 
     }
 
-    if (with_alpha)
-    {
-        for (int y = r.y1; y <= r.y2; y++)
-        {
+    // The colour alpha only counts with 'with_alpha', the coverage always does
+    int const color_alpha = with_alpha ? (color >> 24) : 255;
+    int const alpha = (color_alpha * coverage + 127) / 255;
 
-            pixel* p_ptr = get_pixel_adress (r.x1, y);
+    if (alpha == 0) return;
 
-            for (int x = r.x1; x <= r.x2; x++)
-            {
-                pixel_put_alpha (color, p_ptr); ++p_ptr;
-            }
+    int const span = r.x2 - r.x1 + 1;
+    PIXMAP_PROFILE_SCOPE (PROFILE_DRAW_RECT, (long long) span * (r.y2 - r.y1 + 1), (long long) span * (r.y2 - r.y1 + 1) * sizeof (pixel));
 
-        }
-    }
-    else
-    {
-        for (int y = r.y1; y <= r.y2; y++)
-        {
+    add_damage (r);
 
-            pixel* p_ptr = get_pixel_adress (r.x1, y);
+    // Opaque: plain wide stores, the colour is written as is (in the pixmap format, so not converted)
+    BlendMode const mode = (alpha == 255) ? BLEND_COPY : BLEND_OVER;
+    pixel const front = (alpha == 255) ? color : (color & 0x00FFFFFF) | ((pixel) alpha << 24);
+    PixelFormat const front_format = (alpha == 255) ? format : PIXEL_STRAIGHT;
 
-            for (int x = r.x1; x <= r.x2; x++)
-            {
-                *p_ptr = color; ++p_ptr;
-            }
-        }
-    }
+    for (int y = r.y1; y <= r.y2; y++)
+        composite_solid (front, front_format, get_pixel_adress (r.x1, y), span_format (format), mode, span);
 
 }
 
 void Pixmap::fill (pixel const background_color)
 {
-    for (int i = 0; i < width * height; i++)
-        datas[i] = background_color;
+    PIXMAP_PROFILE_SCOPE (PROFILE_FILL, (long long) width * height, (long long) width * height * sizeof (pixel));
+
+    add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+    // Large surfaces bypass the cache, the next stage will not find them there anyway
+    bool const stream = (long long) width * height * sizeof (pixel) >= FILL_STREAM_MIN_BYTES;
+
+    pixel const color = (format == PIXEL_PREMULTIPLIED) ? pixel_premultiply (background_color) : background_color;
+
+    for_each_band (height, width, [&] (int const y_begin, int const y_end)
+    {
+        if (stream)
+        {
+            fill_rows_stream (datas + y_begin * stride, stride, color, width, y_end - y_begin); // One fence per band
+            return;
+        }
+
+        for (int y = y_begin; y < y_end; y++)
+            fill_span (datas + y * stride, color, width);
+    });
 }
 
 void Pixmap::grayscale () // convert to gray
 {
-    for (int i = 0; i < width * height; i++)
+    grayscale (LUMA_BT601);
+}
+
+void Pixmap::grayscale (LumaCoefficients const luma)
+{
+    PIXMAP_PROFILE_SCOPE (PROFILE_GRAYSCALE, (long long) width * height, (long long) width * height * sizeof (pixel));
+
+    add_damage (Rectbox (0, 0, width - 1, height - 1));
+
+    for_each_band (height, width, [&] (int const y_begin, int const y_end)
     {
-        pixcmp r, g, b, a;
-        pixel_get_rgba (datas[i], &r, &g, &b, &a);
-        pixcmp grey = 0.59 * g + 0.3 * r + 0.11 * b;
-        datas[i] = make_pixel_rgba (grey, grey, grey, a);
-    }
+        for (int y = y_begin; y < y_end; y++)
+            grayscale_span (datas + y * stride, datas + y * stride, width, luma); // Fixed-point, SIMD when available
+    });
 }
 
 void Pixmap::vertical_gradient (Rectbox const &rr, pixel const c_up, pixel const c_down)
 {
+    Gradient const gradient (GRADIENT_VERTICAL, c_up, c_down);
+    draw_gradient (gradient, rr);
+}
 
-    Rectbox R (rr);
+/* Separable box filter with running sums: 'col_sums' holds, for each column, the sum of
+   the vertical window around the current row, then a horizontal running sum over those
+   gives the (2r+1)² window in O(1) per pixel. The window is clamped to the image like
+   'int_restrict' did, and the division uses the real clamped area, so the result is
+   identical to the old per-pixel neighbourhood average.
+   A band starts by summing the window of its first row, so bands are independent.
+   'source_row (y)' gives row y of the unfiltered image, 'before_write (y)' runs just before row
+   y of 'dst' is written (the rows of the window are read before). */
+
+template <class SourceRow, class BeforeWrite>
+static void box_blur_rows (pixel* const dst, int const dst_stride, int const width, int const height, int const radius,
+                           int const y_begin, int const y_end, SourceRow const &source_row, BeforeWrite const &before_write)
+{
 
-    int_restrict (&R.x1, 0, width  - 1);
-    int_restrict (&R.y1, 0, height - 1);
-    int_restrict (&R.x2, 0, width  - 1);
-    int_restrict (&R.y2, 0, height - 1);
+    std::vector<int> col_sums (width * 4, 0);
 
-    pixcmp r_up, g_up, b_up, a_up;
-    pixcmp r_down, g_down, b_down, a_down;
+    int const last_x = width  - 1;
+    int const last_y = height - 1;
 
-    pixel_get_rgba (c_up, &r_up, &g_up, &b_up, &a_up);
-    pixel_get_rgba (c_down, &r_down, &g_down, &b_down, &a_down);
+    for (int y = std::max (y_begin - radius, 0); y <= std::min (y_begin + radius, last_y); y++)
+    {
+        pixel const* s_ptr = source_row (y);
+        int* c_ptr = col_sums.data();
 
-    int pseudo_height = R.y2 - R.y1;
+        for (int x = 0; x < width; x++, s_ptr++, c_ptr += 4)
+        {
+            pixcmp r,g,b,a;
+            pixel_get_rgba (*s_ptr, &r, &g, &b, &a);
+            c_ptr[0] += r; c_ptr[1] += g; c_ptr[2] += b; c_ptr[3] += a;
+        }
+    }
 
-    if (!with_alpha)
+    for (int y = y_begin; y < y_end; y++)
     {
-        for (int y = R.y1; y <= R.y2; y++)
-        {
 
-            float f1 = (y - R.y1) / (pseudo_height + 0.0);
-            float f2 = 1.0 - f1;
+        if (y > y_begin) // Slide the vertical window one row down
+        {
+            int const y_in  = y + radius;
+            int const y_out = y - radius - 1;
 
-            pixcmp r = r_up * f2 + f1 * r_down;
-            pixcmp g = r_up * f2 + f1 * g_down;
-            pixcmp b = r_up * f2 + f1 * b_down;
-            pixcmp a = r_up * f2 + f1 * a_down;
+            pixel const* const in_row  = (y_in  <= last_y) ? source_row (y_in)  : nullptr;
+            pixel const* const out_row = (y_out >= 0)      ? source_row (y_out) : nullptr;
 
-            pixel color = make_pixel_rgba (r, g, b, a);
-            int index = get_pixel_index (R.x1, y);
+            int* c_ptr = col_sums.data();
 
-            for (int x = R.x1; x <= R.x2; x++)
+            for (int x = 0; x < width; x++, c_ptr += 4)
             {
-                datas[index] = color; ++index;
+                pixcmp r,g,b,a;
+
+                if (y_in <= last_y)
+                {
+                    pixel_get_rgba (in_row[x], &r, &g, &b, &a);
+                    c_ptr[0] += r; c_ptr[1] += g; c_ptr[2] += b; c_ptr[3] += a;
+                }
+
+                if (y_out >= 0)
+                {
+                    pixel_get_rgba (out_row[x], &r, &g, &b, &a);
+                    c_ptr[0] -= r; c_ptr[1] -= g; c_ptr[2] -= b; c_ptr[3] -= a;
+                }
             }
-
         }
-    }
-    else
-    {
-        for (int y = R.y1; y <= R.y2; y++)
+
+        int const rows = std::min (y + radius, last_y) - std::max (y - radius, 0) + 1;
+
+        int sum_r = 0, sum_g = 0, sum_b = 0, sum_a = 0;
+
+        for (int x = 0; x <= std::min (radius, last_x); x++)
         {
+            int const* c_ptr = col_sums.data() + x * 4;
+            sum_r += c_ptr[0]; sum_g += c_ptr[1]; sum_b += c_ptr[2]; sum_a += c_ptr[3];
+        }
 
-            float f1 = (y - R.y1) / (pseudo_height + 0.0);
-            float f2 = 1.0 - f1;
+        before_write (y);
 
-            pixcmp r = r_up * f2 + f1 * r_down;
-            pixcmp g = r_up * f2 + f1 * g_down;
-            pixcmp b = r_up * f2 + f1 * b_down;
-            pixcmp a = r_up * f2 + f1 * a_down;
+        pixel* d_ptr = dst + y * dst_stride;
 
-            pixel color = make_pixel_rgba (r, g, b, a);
-            int index = get_pixel_index (R.x1, y);
+        for (int x = 0; x <= last_x; x++, d_ptr++)
+        {
 
-            for (int x = R.x1; x <= R.x2; x++)
+            if (x > 0) // Slide the horizontal window one column right
             {
-                pixel_put_alpha (color, datas + index); ++index;
+                int const x_in  = x + radius;
+                int const x_out = x - radius - 1;
+
+                if (x_in <= last_x)
+                {
+                    int const* c_ptr = col_sums.data() + x_in * 4;
+                    sum_r += c_ptr[0]; sum_g += c_ptr[1]; sum_b += c_ptr[2]; sum_a += c_ptr[3];
+                }
+
+                if (x_out >= 0)
+                {
+                    int const* c_ptr = col_sums.data() + x_out * 4;
+                    sum_r -= c_ptr[0]; sum_g -= c_ptr[1]; sum_b -= c_ptr[2]; sum_a -= c_ptr[3];
+                }
             }
 
+            int const cols = std::min (x + radius, last_x) - std::max (x - radius, 0) + 1;
+            int const area = rows * cols;
+
+            *d_ptr = make_pixel_rgba ((pixcmp) (sum_r / area), (pixcmp) (sum_g / area),
+                                      (pixcmp) (sum_b / area), (pixcmp) (sum_a / area));
+
         }
+
     }
+
 }
 
-pixel Pixmap::get_average_of_neighbors (float const f_radius, int const cx, int const cy) const
+void Pixmap::box_blur (Pixmap const &src, int const radius, int const y_begin, int const y_end)
 {
+    box_blur_rows (datas, stride, width, height, radius, y_begin, y_end,
+                   [&] (int const y) { return src.datas + y * src.stride; }, [] (int const) {});
+}
 
-    int sum_r = 0, sum_g = 0, sum_b = 0, sum_a = 0;
+void Pixmap::average_filter (float const radius)
+{
+    Pixmap clone;
+    clone.pool = pool; // With a pool, the saved rows reuse the previous call's buffer
+    average_filter (radius, clone);
+}
 
-    int radius = (int) f_radius;
+void Pixmap::average_filter (float const radius, Pixmap &scratch)
+{
 
-    int x1 = cx - radius;
-    int y1 = cy - radius;
-    int x2 = cx + radius;
-    int y2 = cy + radius;
+    int const r = (int) radius;
 
-    int_restrict (&x1, 0, width  - 1);
-    int_restrict (&y1, 0, height - 1);
-    int_restrict (&x2, 0, width  - 1);
-    int_restrict (&y2, 0, height - 1);
+    if (r <= 0 || datas == nullptr) return; // A null radius leaves the image unchanged
 
-    int rect_w = x2 - x1 + 1;
-    int rect_h = y2 - y1 + 1;
-    int area = rect_w * rect_h;
+    PIXMAP_PROFILE_SCOPE (PROFILE_AVERAGE_FILTER, (long long) width * height, (long long) width * height * sizeof (pixel));
 
-    for (int y = y1; y <= y2; y++)
-    {
+    /* In place, without copying the image: a band only needs the original rows of its window.
+       The r rows above and below it belong to the neighbour bands, they are saved before any band
+       starts; inside the band, a ring of r + 1 rows keeps the rows already overwritten that the
+       window still covers. 'scratch' holds 3r + 1 rows per band: above, below, ring. */
 
-        int index = get_pixel_index (x1, y);
+    int const bands = band_count (height, width);
+    int const saved_rows = 3 * r + 1;
 
-        for (int x = x1; x <= x2; x++)
-        {
+    scratch.resize (width, bands * saved_rows, with_alpha); // Only reallocated when too small
 
-            pixcmp r,g,b,a;
-            pixel_get_rgba (datas[index], &r, &g, &b, &a);
+    auto const band_begin = [&] (int const k) { return (int) ((long long) height * k / bands); };
+    auto const saved = [&] (int const k, int const i) { return scratch.datas + (k * saved_rows + i) * scratch.stride; };
 
-            sum_r += r;
-            sum_g += g;
-            sum_b += b;
-            sum_a += a;
+    for (int k = 0; k < bands; k++)
+    {
+        int const b = band_begin (k);
+        int const e = band_begin (k + 1);
 
-            ++index;
+        for (int y = std::max (b - r, 0); y < b; y++)
+            std::memcpy (saved (k, y - (b - r)), datas + y * stride, width * sizeof (pixel));
 
-        }
+        for (int y = e; y < std::min (e + r, height); y++)
+            std::memcpy (saved (k, r + y - e), datas + y * stride, width * sizeof (pixel));
     }
 
-    #ifdef DEBUG
-        if (area == 0)
-        {
-
-            std::cout << "Pixmap::get_average_of_neighbors > Null area, non-computable mean." << std::endl;
-
-            return 0xFFFF00FF;
-
-        }
-    #endif
-
-    sum_r /= area;
-    sum_g /= area;
-    sum_b /= area;
-    sum_a /= area;
-
-    return make_pixel_rgba ((pixcmp) sum_r, (pixcmp) sum_g, (pixcmp) sum_b, (pixcmp) sum_a);
+    add_damage (Rectbox (0, 0, width - 1, height - 1));
 
-}
-
-void Pixmap::average_filter (float const radius)
-{
+    auto const blur_band = [&] (int const k)
+    {
+        int const b = band_begin (k);
+        int const e = band_begin (k + 1);
+        int written = b; // Rows [b, written) of the band are already blurred
 
-    Pixmap clone = Pixmap (*this);
+        box_blur_rows (datas, stride, width, height, r, b, e,
+            [&] (int const y) -> pixel const*
+            {
+                if (y < b)       return saved (k, y - (b - r));
+                if (y >= e)      return saved (k, r + y - e);
+                if (y < written) return saved (k, 2 * r + (y - b) % (r + 1));
+                return datas + y * stride;
+            },
+            [&] (int const y)
+            {
+                std::memcpy (saved (k, 2 * r + (y - b) % (r + 1)), datas + y * stride, width * sizeof (pixel));
+                written = y + 1;
+            });
+    };
 
-    int i = 0;
+    if (bands == 1)
+    {
+        blur_band (0);
+        return;
+    }
 
-    for (int y = 0; y < height; y++)
+    executor -> parallel_for (bands, bands, [&] (int const k_begin, int const k_end)
     {
-        for (int x = 0; x < width; x++)
+        for (int k = k_begin; k < k_end; k++)
         {
-            datas[i] = clone.get_average_of_neighbors (radius, x, y); ++i;
+            PIXMAP_PROFILE_SCOPE (PROFILE_BAND, (long long) width * (band_begin (k + 1) - band_begin (k)), 0);
+            blur_band (k);
         }
-    }
+    });
 
 }
 
@@ -362,14 +946,14 @@ pixel Pixmap::read_pixel (int const x, int const y) const
     {
 
         #ifdef DEBUG
-            std::cout << "Pixmap::read_pixel > Pixel ' " << x << " : " << y << " ' is out of limit." << std::endl;
+            pixel_out_of_limit ("Pixmap::read_pixel", x, y);
         #endif
 
         return 0;
 
     }
 
-    return datas[y * width + x];
+    return datas[y * stride + x];
 
 }
 
@@ -379,13 +963,14 @@ void Pixmap::write_pixel (int const x, int const y, pixel const color)
     {
 
         #ifdef DEBUG
-            std::cout << "Pixmap::write_pixel > Pixel ' " << x << " : " << y << " ' is out of limit." << std::endl;
+            pixel_out_of_limit ("Pixmap::write_pixel", x, y);
         #endif
 
         return;
     }
 
-    datas[y * width + x] = color;
+    datas[y * stride + x] = color;
+    add_damage (Rectbox (x, y, x, y));
 
 }
 
@@ -399,6 +984,16 @@ int Pixmap::get_height () const
     return height;
 }
 
+int Pixmap::get_stride () const
+{
+    return stride;
+}
+
+bool Pixmap::has_alpha () const
+{
+    return with_alpha;
+}
+
 pixel* Pixmap::get_pixels () const
 {
     return datas;
@@ -11,10 +11,58 @@
 #ifndef __PIXMAP_HPP__
 #define __PIXMAP_HPP__
 
+#include <functional>
+#include <vector>
+
 typedef uint8_t  pixcmp; // cmp: component (of a pixel)
 typedef uint32_t pixel;
 
+enum LumaCoefficients {
+    LUMA_BT601, // 0.299 R + 0.587 G + 0.114 B (SD video, close to the historical 0.3/0.59/0.11)
+    LUMA_BT709  // 0.2126 R + 0.7152 G + 0.0722 B (HD video, sRGB)
+};
+
+enum PixelFormat {
+    PIXEL_STRAIGHT,      // ARGB, colour independent of alpha (SDL textures, API colours)
+    PIXEL_PREMULTIPLIED  // ARGB with the colour already multiplied by alpha: cheaper "over", fringe-free filtering
+};
+
+enum BorderMode {   // Pixels read outside the image by the filters (Filter.hpp)
+    BORDER_CLAMP,   // Nearest edge pixel, like 'int_restrict'
+    BORDER_WRAP,    // Opposite edge (tiling textures)
+    BORDER_MIRROR   // Reflected without repeating the edge pixel
+};
+
+enum SampleMode {      // Source sampling of the transformed blits (Warp.hpp)
+    SAMPLE_NEAREST,
+    SAMPLE_BILINEAR    // 4 neighbours, 8-bit weights, edges clamped
+};
+
+enum BlendMode {      // How drawn pixels combine with the target (Composite.hpp)
+    BLEND_COPY,       // Replaced, the source alpha included
+    BLEND_OVER,       // "src over dst"
+    BLEND_ADD,        // Saturated sum
+    BLEND_MULTIPLY,   // Darkens the target by the source colour
+    BLEND_MODE_COUNT
+};
+
+typedef std::function<int (int const y)> RowDisplacement; // Horizontal shift of target row 'y', 16.16 fixed point
+
+#define PIXMAP_ROW_ALIGN 64 // Bytes: every row of an owned buffer starts on a cache line (and a 16/32-byte vector boundary)
+
+pixel* pixels_alloc (int const count);  // 'count' pixels aligned on PIXMAP_ROW_ALIGN
+void pixels_free (pixel* const buffer); // Frees a buffer from 'pixels_alloc'
+int pixels_aligned_stride (int const width); // Row length in pixels, rounded up to PIXMAP_ROW_ALIGN
+
 void int_restrict (int* const value, int const vmin, int const vmax);
+void pixel_out_of_limit (char const* const function, int const x, int const y); // DEBUG report, out of line so the inline accessors stay small
+
+class ThreadPool;
+class PixelPool;
+class Gradient;
+class Graymap;
+class SeparableKernel;
+struct AffineTransform;
 
 struct Rectbox {
 
@@ -24,54 +72,126 @@ struct Rectbox {
   Rectbox ();
   Rectbox (int const x1, int const y1, int const x2, int const y2);
   Rectbox (Rectbox const &R); // Re-copy constructor
+  Rectbox& operator= (Rectbox const &R);
   void setter (int const x1, int const y1, int const x2, int const y2);
 
 };
 
 class Pixmap {
 
+  friend class Pipeline; // Runs the row-level operations ('box_blur', 'for_each_band') on bands
+  friend class DrawList; // Executes recorded commands scanline by scanline on the raw rows
+  friend class PixmapView; // Points into the rows of its parent and marks the parent's damage
+  friend class BlurCache;  // Row passes of the box filter on the source and target rows, banded on the target executor
+
   private:
     int width;
     int height;
+    int stride;           // Pixels from one row to the next (>= width)
     pixel* datas;
+    int capacity;         // Number of pixels allocated in 'datas' (>= stride * height)
+    bool owns_datas;      // False when wrapping an external buffer (locked texture, mapped file...)
     bool with_alpha;
+    PixelFormat format;   // How the stored pixels are encoded, colours given to the API are always straight
+    ThreadPool* executor; // Optional, not owned (nullptr: everything runs on the calling thread)
+    PixelPool* pool;      // Optional, not owned (nullptr: 'pixels_alloc' / 'pixels_free')
+
+    bool track_damage;            // When true, every write records the rect it touched in 'damage'
+    std::vector<Rectbox> damage;  // Clipped, inclusive coordinates like Rectbox
 
     void init(int const width, int const height, bool const alpha);
 
-    pixel get_average_of_neighbors (float const f_radius, int const cx, int const cy) const;
+    void allocate (int const count); // Sets 'datas' and 'capacity', from 'pool' when there is one
+    void release ();                 // Frees 'datas' or gives it back to 'pool' (nothing for a wrapped buffer)
+    void copy_rows (Pixmap const &pix); // Copies the content of 'pix' (same size, any stride)
+
+    int band_count (int const rows, int const span_width) const; // Bands 'for_each_band' splits 'rows' into, 1 when they all run on the calling thread
+    void for_each_band (int const rows, int const span_width, std::function<void (int, int)> const &job) const; // Runs 'job (begin, end)' over row bands of [0, rows) 'span_width' pixels wide
+
+    bool clip_rect (Rectbox* const rect) const; // Clamps 'rect' to the pixmap, false if nothing is left
+    void add_damage (Rectbox const &rect);      // Merged with the last recorded rect when they touch
+
+    void box_blur (Pixmap const &src, int const radius, int const y_begin, int const y_end); // Writes rows [y_begin, y_end) of the box-filtered 'src' (same size)
+    void convolve_into (Pixmap &dst, SeparableKernel const &horizontal, SeparableKernel const &vertical,
+                        BorderMode const border, bool const absolute) const; // 'dst' must have the same size, |result| when 'absolute'
 
   public:
     Pixmap  ();
     Pixmap  (int const width, int const height);
     Pixmap  (int const width, int const height, int const background_color, bool const alpha);
-    Pixmap  (Pixmap const & pix); // Re-copy constructor.
+    Pixmap  (int const width, int const height, bool const alpha, PixelPool* const pool); // Buffer taken from 'pool', uninitialized
+    Pixmap  (pixel* const buffer, int const width, int const height, int const stride, bool const alpha); // Wraps 'buffer' without copying nor owning it
+    Pixmap  (Pixmap const & pix); // Re-copy constructor. A copy of a tracked pixmap starts fully damaged
+    Pixmap  (Pixmap && pix) noexcept; // Move constructor, 'pix' is left empty (noexcept: vectors of Pixmap move instead of copying)
     ~Pixmap ();
 
+    Pixmap& operator= (Pixmap const & pix); // Reuses the current buffer when it is large enough, keeps its executor, pool and damage tracking
+    Pixmap& operator= (Pixmap && pix) noexcept; // Takes everything from 'pix' like the move constructor, executor and pool included
+
+    void resize (int const width, int const height, bool const alpha); // Content undefined afterwards, reallocates only when growing (a wrapped buffer too small for the new rows is left for an owned one)
+    void set_pool (PixelPool* const pool); // Buffers allocated from now on come from 'pool', and are given back to it
+
+    void set_executor (ThreadPool* const pool); // Splits whole-image operations into row bands on 'pool' (nullptr to disable)
+
+    void set_format (PixelFormat const format); // Converts the content (premultiplying is lossy for low alphas)
+    PixelFormat get_format () const;
+
     void blit_on_texture_centered (SDL_Texture* const texture, int const texture_w, int const texture_h) const;
-    void blit_on_texture (SDL_Texture* const texture, int const x1, int const y1) const;
+    void blit_on_texture (SDL_Texture* const texture, int const x1, int const y1) const; // With damage tracking, uploads the damaged rects only. Always straight ARGB
+
+    void set_damage_tracking (bool const enabled); // Off by default, enabling it marks the whole pixmap as damaged
+    std::vector<Rectbox> const& get_damage () const;
+    Rectbox get_damage_bounds () const; // Rectbox() (all -1) when nothing is damaged
+    void merge_damage ();               // Replaces touching/overlapping rects by their bounding box
+    void clear_damage ();               // Call once the damaged area has been presented
 
-    void blit_line (Pixmap const &pix, int const line_number, int const x1, int const y1) const;
+    void restore (Pixmap const &layer, Rectbox const &rect); // Copies 'rect' back from a cached layer of the same size (e.g. a static background)
+
+    void blit_line (Pixmap &pix, int const line_number, int const x1, int const y1) const;              // Clipped against 'pix', converted to its format
+    void blit_line (Pixmap &pix, int const line_number, int const x1, int const y1, BlendMode const mode) const; // Same with any blend mode (the one above: "over", copy without alpha)
+    void blit_line_subpixel (Pixmap &pix, int const line_number, int64_t const x1_fx, int const y1) const; // 'x1_fx' in 16.16 fixed point (64 bits: any int position), horizontal linear filtering
+
+    // Whole pixmap drawn through 'transform' (Warp.hpp), clipped against 'pix' and converted to its format.
+    // Returns the written area, Rectbox() (all -1) when nothing was drawn
+    Rectbox blit_transformed (Pixmap &pix, AffineTransform const &transform, SampleMode const mode) const;
+    Rectbox blit_transformed (Pixmap &pix, AffineTransform const &transform, SampleMode const mode, RowDisplacement const &displacement) const;
 
     void draw_rect (Rectbox const &rect, pixel const color);    // (non-secure) Does not test for overtaking but faster. ! (does not manage the alpha channel)!
     void draw_rectbox (Rectbox const &rect, pixel const color); // (secure)     Test for pixmap overflows therefore slower.
+    void draw_rectbox (Rectbox const &rect, pixel const color, pixcmp const coverage); // Same, alpha scaled by 'coverage' (0-255), opaque result filled without blending
 
     void fill (pixel const background_color); // Fill the pixmap with the desired color
-    void grayscale (); // Converted to gray
+    void grayscale (); // Converted to gray (BT.601)
+    void grayscale (LumaCoefficients const luma);
+    void to_graymap (Graymap &gray, LumaCoefficients const luma) const; // Luma into a 8-bit single-channel image (resized to fit)
 
     void vertical_gradient (Rectbox const &rr, pixel const c_width, pixel const c_height);
+    void draw_gradient (Gradient const &gradient, Rectbox const &rect); // Any direction and stops (Gradient.hpp)
 
     int get_pixel_index (int const x, int const y) const;
     pixel* get_pixel_adress (int const x, int const y) const;
 
-    void average_filter (float const radius); // Blur effect
+    void average_filter (float const radius);                  // Blur effect (linear: premultiplied pixmaps blur without colour fringes)
+    void average_filter (float const radius, Pixmap &scratch); // Same, 'scratch' keeps the 3r + 1 source rows each band still needs (only reallocated if too small)
+
+    void convolve (SeparableKernel const &horizontal, SeparableKernel const &vertical, BorderMode const border); // Any separable kernel (Filter.hpp)
+    void convolve (SeparableKernel const &horizontal, SeparableKernel const &vertical, BorderMode const border, Pixmap &scratch);
+    void gaussian_blur (float const sigma, BorderMode const border);
+    void gaussian_blur (float const sigma, BorderMode const border, Pixmap &scratch);
+    void sharpen (float const amount, float const sigma, BorderMode const border); // Unsharp mask: src + amount * (src - gaussian)
+    void sharpen (float const amount, float const sigma, BorderMode const border, Pixmap &scratch);
+    void edge_detect (BorderMode const border); // Sobel, |Gx| + |Gy| per channel, alpha kept
+    void edge_detect (BorderMode const border, Pixmap &scratch); // The 'scratch' overloads keep their temporary image there (only reallocated if too small)
 
-    pixel read_pixel (int const x, int const y) const;
-    void write_pixel (int const x, int const y, pixel const color);
+    pixel read_pixel (int const x, int const y) const;              // Raw, in the pixmap format
+    void write_pixel (int const x, int const y, pixel const color); // Raw, in the pixmap format
 
     // NOTE: faire une seule fonction pour 'get_win_size() : ret -> w,h'
 
     int get_width  () const;
     int get_height () const;
+    int get_stride () const; // In pixels, the SDL pitch is 'get_stride() * sizeof (pixel)'
+    bool has_alpha () const;
 
     pixel* get_pixels () const;
 
@@ -97,7 +217,7 @@ inline pixel make_pixel_rgba (pixcmp const r, pixcmp const g, pixcmp const b, pi
 
 inline int Pixmap::get_pixel_index (int const x, int const y) const
 {
-    return y * width + x;
+    return y * stride + x;
 }
 
 inline pixel* Pixmap::get_pixel_adress (int const x, int const y) const
@@ -106,16 +226,22 @@ inline pixel* Pixmap::get_pixel_adress (int const x, int const y) const
     #ifdef DEBUG
         if ((x < 0) || (y < 0) || (x >= width) || (y >= height))
         {
-            std::cout << "Pixmap::get_pixel_adress > Pixel ' " << x << " : " << y << " ' is out of limit." << std::endl;
+            pixel_out_of_limit ("Pixmap::get_pixel_adress", x, y);
             return NULL;
         }
     #endif
 
-    return datas + y * width + x;
+    return datas + y * stride + x;
 
 }
 
-inline void pixel_put_alpha (pixel const front, pixel* const bottom)
+inline pixcmp blend_component (int const front, int const bottom, int const alpha)
+{
+    int const t = front * alpha + bottom * (255 - alpha) + 128;
+    return (t + (t >> 8)) >> 8; // Exact rounded division by 255 (t < 2^16)
+}
+
+inline void pixel_put_alpha (pixel const front, pixel* const bottom) // Scalar reference of 'blend_span' (Blend.hpp)
 {
     pixcmp r,g,b,a;
     pixel_get_rgba (front, &r, &g, &b, &a);
@@ -123,16 +249,32 @@ inline void pixel_put_alpha (pixel const front, pixel* const bottom)
     pixcmp rr,gg,bb,aa;
     pixel_get_rgba (*bottom, &rr, &gg, &bb, &aa);
 
-    float f1 = a / 255.0;
-    float f2 = 1.0 - f1;
+    *bottom = make_pixel_rgba (blend_component (r, rr, a), blend_component (g, gg, a),
+                               blend_component (b, bb, a), blend_component (a, aa, a));
+
+}
 
-    r = rr * f2 + f1 * r;
-    g = gg * f2 + f1 * g;
-    b = bb * f2 + f1 * b;
-    a = aa * f2 + f1 * a;
+inline pixel pixel_premultiply (pixel const colour)
+{
+    pixcmp r,g,b,a;
+    pixel_get_rgba (colour, &r, &g, &b, &a);
+
+    // blend_component (c, 0, a) is c * a / 255 with the same rounding as the blends
+    return make_pixel_rgba (blend_component (r, 0, a), blend_component (g, 0, a), blend_component (b, 0, a), a);
+}
+
+inline void pixel_put_alpha_premultiplied (pixel const front, pixel* const bottom) // Scalar reference of 'blend_span_premultiplied'
+{
+    int const ia = 255 - (front >> 24);
+    pixel out = 0;
 
-    *bottom = make_pixel_rgba (r, g, b, a);
+    for (int c = 0; c < 32; c += 8)
+    {
+        int const v = ((front >> c) & 0xFF) + blend_component (0, (*bottom >> c) & 0xFF, 255 - ia);
+        out |= (pixel) (v > 255 ? 255 : v) << c;
+    }
 
+    *bottom = out;
 }
 
 #endif
@@ -0,0 +1,122 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "PixmapView.hpp"
+
+void PixmapView::bind (Pixmap const &parent, Rectbox const &rect)
+{
+
+    Rectbox r (rect);
+    bool const inside = parent.datas != nullptr && parent.clip_rect (&r);
+
+    if (owns_datas) Pixmap::release(); // A detached view frees its own buffer first
+
+    this -> width  = inside ? r.x2 - r.x1 + 1 : 0;
+    this -> height = inside ? r.y2 - r.y1 + 1 : 0;
+    this -> stride = parent.stride;
+    this -> datas  = inside ? parent.datas + r.y1 * parent.stride + r.x1 : nullptr;
+    this -> capacity = 0;       // Never reused by 'resize': the rows of a view are interleaved with the parent's
+    this -> owns_datas = false;
+    this -> with_alpha = parent.with_alpha;
+    this -> format = parent.format;
+    this -> executor = nullptr; // Not the parent's: a tile per thread would post several jobs to the same pool
+    this -> pool = parent.pool; // For the buffer of a detached view
+    this -> track_damage = false;
+    this -> damage.clear();
+
+    this -> x1 = inside ? r.x1 : 0;
+    this -> y1 = inside ? r.y1 : 0;
+
+    #ifdef DEBUG
+        if (!inside) std::cout << "PixmapView::bind > Empty view." << std::endl;
+    #endif
+
+}
+
+PixmapView::PixmapView () : Pixmap (nullptr, 0, 0, 0, false)
+{
+    x1 = y1 = 0;
+}
+
+PixmapView::PixmapView (Pixmap &parent, Rectbox const &rect) : Pixmap (nullptr, 0, 0, 0, false)
+{
+    bind (parent, rect);
+
+    if (width > 0) parent.add_damage (Rectbox (x1, y1, x1 + width - 1, y1 + height - 1));
+}
+
+PixmapView::PixmapView (Pixmap const &parent, Rectbox const &rect) : Pixmap (nullptr, 0, 0, 0, false)
+{
+    bind (parent, rect);
+}
+
+PixmapView::PixmapView (PixmapView const &view) : Pixmap (nullptr, 0, 0, 0, false)
+{
+    *this = view;
+}
+
+PixmapView& PixmapView::operator= (PixmapView const &view)
+{
+
+    if (this == &view) return *this;
+
+    if (owns_datas) Pixmap::release();
+
+    width  = view.width;
+    height = view.height;
+    stride = view.stride;
+    datas  = view.datas; // The parent's pixels (or, if 'view' was detached, its own buffer: it must then outlive this one)
+    capacity = 0;
+    owns_datas = false;
+    with_alpha = view.with_alpha;
+    format = view.format;
+    executor = view.executor;
+    pool = view.pool;
+    track_damage = false;
+    damage.clear();
+
+    x1 = view.x1;
+    y1 = view.y1;
+
+    return *this;
+
+}
+
+int PixmapView::get_x () const
+{
+    return x1;
+}
+
+int PixmapView::get_y () const
+{
+    return y1;
+}
+
+std::vector<PixmapView> split_tiles (Pixmap &parent, int const tile_w, int const tile_h)
+{
+
+    std::vector<PixmapView> tiles;
+    if (tile_w <= 0 || tile_h <= 0) return tiles;
+
+    int const w = parent.get_width();
+    int const h = parent.get_height();
+
+    if (w > 0 && h > 0) tiles.reserve ((size_t) ((w + tile_w - 1) / tile_w) * ((h + tile_h - 1) / tile_h));
+
+    for (int y = 0; y < h; y += tile_h)
+        for (int x = 0; x < w; x += tile_w)
+            tiles.emplace_back (parent, Rectbox (x, y, x + tile_w - 1, y + tile_h - 1));
+
+    return tiles;
+
+}
@@ -0,0 +1,52 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __PIXMAPVIEW_HPP__
+#define __PIXMAPVIEW_HPP__
+
+#include <vector>
+#include "Pixmap.hpp"
+
+/* Window on a rectangle of another Pixmap: the same pixels (no copy, no allocation), seen through
+   the parent's stride from the rect origin. A view is a Pixmap, so every operation and blit
+   accepts it: blur or grayscale one region, or give each thread its own tile.
+   It takes the format and pool of its parent ('set_format' on a view converts its pixels, the
+   parent keeps its own format), not its executor: views are usually one tile per thread, so
+   their operations run on the calling thread unless 'set_executor' says otherwise. Writes through a view are not tracked
+   one by one: a parent that tracks damage gets the whole rect marked once, when the view is made.
+   The parent must outlive its views and must not be resized meanwhile. Views whose rects do not
+   overlap can be written from different threads. Resizing a view detaches it into an owned
+   pixmap, the parent is left untouched; assigning a view to another rebinds it (no pixel copy). */
+
+class PixmapView : public Pixmap {
+
+  private:
+    int x1; // Origin in the parent
+    int y1;
+
+    void bind (Pixmap const &parent, Rectbox const &rect); // Clipped 'rect', empty (0 x 0) if nothing is left
+
+  public:
+    PixmapView ();                                          // Empty
+    PixmapView (Pixmap &parent, Rectbox const &rect);       // Marks 'rect' damaged in the parent
+    PixmapView (Pixmap const &parent, Rectbox const &rect); // To read from (blit sources...), marks nothing
+    PixmapView (PixmapView const &view);                    // Another view of the same rect, not a copy of the pixels
+
+    PixmapView& operator= (PixmapView const &view);         // Same: rebinds
+
+    int get_x () const; // Origin in the parent
+    int get_y () const;
+
+};
+
+// Views of 'tile_w' x 'tile_h' covering 'parent' row by row (smaller on the right and bottom edges)
+std::vector<PixmapView> split_tiles (Pixmap &parent, int const tile_w, int const tile_h);
+
+#endif
@@ -0,0 +1,254 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "Profile.hpp"
+
+static char const* const op_names[PROFILE_OP_COUNT] = {
+    "fill", "draw_rectbox", "blit_line", "blit_transformed", "blit_on_texture", "restore", "draw_gradient", "grayscale",
+    "average_filter", "convolve", "set_format", "draw_list", "pipeline", "band"
+};
+
+struct ProfileEvent {
+    ProfileOp op;
+    long long start; // ns since the first event of the process
+    long long duration;
+    unsigned long long pixels;
+    unsigned long long bytes;
+};
+
+struct ProfileThread {
+
+  ProfileCounter counters[PROFILE_OP_COUNT];
+  std::vector<ProfileEvent> events;
+  int id; // Small number given in registration order (the Chrome "tid")
+
+  ProfileThread ();
+  ~ProfileThread ();
+
+};
+
+/* Every live thread is registered, the counters of a thread that exits are kept in 'retired' */
+
+struct ProfileRegistry {
+
+  std::mutex lock;
+  std::vector<ProfileThread*> threads;
+  ProfileCounter retired[PROFILE_OP_COUNT] = {};
+  std::vector<std::pair<int, ProfileEvent>> retired_events;
+  int next_id = 0;
+  std::atomic<bool> tracing {false};
+
+};
+
+static ProfileRegistry& registry ()
+{
+    static ProfileRegistry instance;
+    return instance;
+}
+
+ProfileThread::ProfileThread ()
+{
+    std::fill (counters, counters + PROFILE_OP_COUNT, ProfileCounter {0, 0, 0, 0});
+
+    ProfileRegistry &r = registry();
+    std::lock_guard<std::mutex> guard (r.lock);
+
+    id = r.next_id++;
+    r.threads.push_back (this);
+}
+
+ProfileThread::~ProfileThread ()
+{
+    ProfileRegistry &r = registry();
+    std::lock_guard<std::mutex> guard (r.lock);
+
+    for (int op = 0; op < PROFILE_OP_COUNT; op++)
+    {
+        r.retired[op].calls  += counters[op].calls;
+        r.retired[op].pixels += counters[op].pixels;
+        r.retired[op].bytes  += counters[op].bytes;
+        r.retired[op].ns     += counters[op].ns;
+    }
+
+    for (ProfileEvent const &event : events) r.retired_events.push_back ({id, event});
+
+    r.threads.erase (std::find (r.threads.begin(), r.threads.end(), this));
+}
+
+/* SCOPES */
+
+#ifdef PIXMAP_PROFILE
+
+static long long now_ns ()
+{
+    static std::chrono::steady_clock::time_point const origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now() - origin).count();
+}
+
+static ProfileThread& this_thread_profile ()
+{
+    static thread_local ProfileThread profile;
+    return profile;
+}
+
+ProfileScope::ProfileScope (ProfileOp const op, long long const pixels, long long const bytes)
+{
+    this -> op = op;
+    this -> pixels = pixels;
+    this -> bytes = bytes;
+    this -> start = now_ns();
+}
+
+ProfileScope::~ProfileScope ()
+{
+    long long const duration = now_ns() - start;
+
+    ProfileThread &profile = this_thread_profile();
+    ProfileCounter &counter = profile.counters[op];
+
+    counter.calls++;
+    counter.pixels += pixels;
+    counter.bytes  += bytes;
+    counter.ns     += duration;
+
+    if (registry().tracing.load (std::memory_order_relaxed) && profile.events.size() < PROFILE_MAX_EVENTS)
+        profile.events.push_back ({op, start, duration, pixels, bytes});
+}
+
+#endif
+
+/* READING */
+
+char const* profile_op_name (ProfileOp const op)
+{
+    return (op >= 0 && op < PROFILE_OP_COUNT) ? op_names[op] : "unknown";
+}
+
+void profile_reset ()
+{
+    ProfileRegistry &r = registry();
+    std::lock_guard<std::mutex> guard (r.lock);
+
+    for (ProfileThread* const thread : r.threads)
+    {
+        std::fill (thread -> counters, thread -> counters + PROFILE_OP_COUNT, ProfileCounter {0, 0, 0, 0});
+        thread -> events.clear();
+    }
+
+    std::fill (r.retired, r.retired + PROFILE_OP_COUNT, ProfileCounter {0, 0, 0, 0});
+    r.retired_events.clear();
+}
+
+void profile_set_tracing (bool const enabled)
+{
+    registry().tracing = enabled;
+}
+
+void profile_get_counters (ProfileCounter* const counters)
+{
+    ProfileRegistry &r = registry();
+    std::lock_guard<std::mutex> guard (r.lock);
+
+    std::copy (r.retired, r.retired + PROFILE_OP_COUNT, counters);
+
+    for (ProfileThread const* const thread : r.threads)
+    {
+        for (int op = 0; op < PROFILE_OP_COUNT; op++)
+        {
+            counters[op].calls  += thread -> counters[op].calls;
+            counters[op].pixels += thread -> counters[op].pixels;
+            counters[op].bytes  += thread -> counters[op].bytes;
+            counters[op].ns     += thread -> counters[op].ns;
+        }
+    }
+}
+
+std::string profile_to_json ()
+{
+    ProfileCounter counters[PROFILE_OP_COUNT];
+    profile_get_counters (counters);
+
+    std::string json = "{";
+    char entry[256];
+
+    for (int op = 0; op < PROFILE_OP_COUNT; op++)
+    {
+        std::snprintf (entry, sizeof (entry), "%s\n  \"%s\": {\"calls\": %llu, \"pixels\": %llu, \"bytes\": %llu, \"ns\": %llu}",
+                       op == 0 ? "" : ",", op_names[op], counters[op].calls, counters[op].pixels, counters[op].bytes, counters[op].ns);
+        json += entry;
+    }
+
+    return json + "\n}\n";
+}
+
+bool profile_write_json (char const* const path)
+{
+    FILE* const file = fopen (path, "wb");
+
+    if (file == NULL)
+    {
+        #ifdef DEBUG
+            std::cout << "profile_write_json > Cannot create '" << path << "'." << std::endl;
+        #endif
+
+        return false;
+    }
+
+    std::string const json = profile_to_json();
+    bool const ok = fwrite (json.data(), 1, json.size(), file) == json.size();
+
+    return (fclose (file) == 0) && ok;
+}
+
+bool profile_write_chrome_trace (char const* const path)
+{
+    FILE* const file = fopen (path, "wb");
+
+    if (file == NULL)
+    {
+        #ifdef DEBUG
+            std::cout << "profile_write_chrome_trace > Cannot create '" << path << "'." << std::endl;
+        #endif
+
+        return false;
+    }
+
+    ProfileRegistry &r = registry();
+    std::lock_guard<std::mutex> guard (r.lock);
+
+    bool first = true;
+
+    // Complete events ("ph": "X"), times in microseconds
+    auto const write_event = [&] (int const tid, ProfileEvent const &event)
+    {
+        fprintf (file, "%s\n{\"name\": \"%s\", \"cat\": \"pixmap\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+                       "\"args\": {\"pixels\": %llu, \"bytes\": %llu}}",
+                 first ? "" : ",", op_names[event.op], tid, event.start * 0.001, event.duration * 0.001, event.pixels, event.bytes);
+        first = false;
+    };
+
+    fprintf (file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+
+    for (auto const &retired : r.retired_events) write_event (retired.first, retired.second);
+
+    for (ProfileThread const* const thread : r.threads)
+        for (ProfileEvent const &event : thread -> events) write_event (thread -> id, event);
+
+    bool const ok = fprintf (file, "\n]}\n") > 0;
+
+    return (fclose (file) == 0) && ok;
+}
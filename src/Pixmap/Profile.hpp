@@ -0,0 +1,91 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __PROFILE_HPP__
+#define __PROFILE_HPP__
+
+#include <string>
+
+/* Per-operation counters: calls, pixels touched, bytes written and time spent (inclusive, in
+   nanoseconds), kept per thread so the hot paths never share a cache line or take a lock.
+   Everything is compiled in with -DPIXMAP_PROFILE only: otherwise PIXMAP_PROFILE_SCOPE expands
+   to nothing and the functions below report zeros.
+   The counters of every thread are summed when read: read them between operations (e.g. once
+   per frame), not while a band of another thread is still running. */
+
+#define PROFILE_MAX_EVENTS (1 << 20) // Per thread, for the trace (calls beyond are counted, not traced)
+
+enum ProfileOp {
+    PROFILE_FILL,
+    PROFILE_DRAW_RECT,
+    PROFILE_BLIT_LINE,     // 'blit_line' and 'blit_line_subpixel'
+    PROFILE_BLIT_TRANSFORMED,
+    PROFILE_BLIT_TEXTURE,
+    PROFILE_RESTORE,
+    PROFILE_GRADIENT,
+    PROFILE_GRAYSCALE,
+    PROFILE_AVERAGE_FILTER,
+    PROFILE_CONVOLVE,      // 'convolve', 'gaussian_blur', 'sharpen', 'edge_detect'
+    PROFILE_SET_FORMAT,
+    PROFILE_DRAW_LIST,
+    PROFILE_PIPELINE,
+    PROFILE_BAND,          // One row band run by a worker of the executor
+    PROFILE_OP_COUNT
+};
+
+struct ProfileCounter {
+    unsigned long long calls;
+    unsigned long long pixels;
+    unsigned long long bytes;
+    unsigned long long ns;
+};
+
+char const* profile_op_name (ProfileOp const op);
+
+void profile_reset ();                     // Zeroes the counters and drops the trace of every thread
+void profile_set_tracing (bool const enabled); // Off by default: each call is also recorded (thread, start, duration)
+void profile_get_counters (ProfileCounter* const counters); // PROFILE_OP_COUNT entries, summed over the threads
+
+std::string profile_to_json ();                           // {"operation": {"calls": .., "pixels": .., "bytes": .., "ns": ..}, ...}
+bool profile_write_json (char const* const path);
+bool profile_write_chrome_trace (char const* const path); // Trace Event Format, opens in chrome://tracing or Perfetto
+
+#ifdef PIXMAP_PROFILE
+
+class ProfileScope {
+
+  private:
+    ProfileOp op;
+    unsigned long long pixels;
+    unsigned long long bytes;
+    long long start; // ns
+
+  public:
+    ProfileScope (ProfileOp const op, long long const pixels, long long const bytes);
+    ~ProfileScope ();
+
+    ProfileScope (ProfileScope const &) = delete;
+    ProfileScope& operator= (ProfileScope const &) = delete;
+
+};
+
+#define PIXMAP_PROFILE_NAME_(line) profile_scope_ ## line
+#define PIXMAP_PROFILE_NAME(line)  PIXMAP_PROFILE_NAME_(line)
+
+// Counts the enclosing block as one call of 'op'
+#define PIXMAP_PROFILE_SCOPE(op, pixels, bytes) ProfileScope const PIXMAP_PROFILE_NAME (__LINE__) (op, pixels, bytes)
+
+#else
+
+#define PIXMAP_PROFILE_SCOPE(op, pixels, bytes) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <SDL2/SDL.h>
+#include "StreamingTexture.hpp"
+
+StreamingTexture::StreamingTexture (SDL_Renderer* const renderer, int const width, int const height, int const buffers)
+{
+    this -> width  = width;
+    this -> height = height;
+
+    buffer_count = (buffers >= 2) ? 2 : 1;
+
+    for (int i = 0; i < STREAMING_MAX_BUFFERS; i++)
+    {
+        textures[i] = nullptr;
+        locked[i] = false;
+    }
+
+    for (int i = 0; i < buffer_count; i++)
+        textures[i] = SDL_CreateTexture (renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+}
+
+StreamingTexture::~StreamingTexture ()
+{
+    for (int i = 0; i < buffer_count; i++)
+    {
+        if (locked[i]) unlock (i);
+        if (textures[i] != nullptr) SDL_DestroyTexture (textures[i]);
+    }
+}
+
+bool StreamingTexture::is_valid () const
+{
+    for (int i = 0; i < buffer_count; i++)
+        if (textures[i] == nullptr) return false;
+
+    return true;
+}
+
+int StreamingTexture::get_buffer_count () const
+{
+    return buffer_count;
+}
+
+bool StreamingTexture::lock (int const buffer, Pixmap &frame)
+{
+
+    if (buffer < 0 || buffer >= buffer_count || textures[buffer] == nullptr) return false;
+    if (locked[buffer]) unlock (buffer); // SDL hands out new memory on each lock
+
+    void* pixels;
+    int pitch;
+
+    if (SDL_LockTexture (textures[buffer], NULL, &pixels, &pitch) < 0)
+    {
+
+        #ifdef DEBUG
+            std::cout << "StreamingTexture::lock > " << SDL_GetError() << std::endl;
+        #endif
+
+        return false;
+
+    }
+
+    frame = Pixmap ((pixel*) pixels, width, height, pitch / (int) sizeof (pixel), false);
+    locked[buffer] = true;
+
+    return true;
+
+}
+
+void StreamingTexture::unlock (int const buffer)
+{
+    if (buffer < 0 || buffer >= buffer_count || !locked[buffer]) return;
+
+    SDL_UnlockTexture (textures[buffer]);
+    locked[buffer] = false;
+}
+
+SDL_Texture* StreamingTexture::get_texture (int const buffer) const
+{
+    return (buffer >= 0 && buffer < buffer_count) ? textures[buffer] : nullptr;
+}
@@ -0,0 +1,52 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __STREAMINGTEXTURE_HPP__
+#define __STREAMINGTEXTURE_HPP__
+
+#include "Pixmap.hpp"
+
+#define STREAMING_MAX_BUFFERS 2
+
+/* Presentation without intermediate copy: 'lock' wraps the memory of one of the
+   SDL_TEXTUREACCESS_STREAMING textures in a Pixmap, the frame is drawn straight into it, and
+   'unlock' makes that texture ready for SDL_RenderCopy. Each buffer has its own texture and
+   may stay locked while another one is presented (double buffering, e.g. as the buffers of a
+   FrameScheduler).
+   The locked memory is write-only for SDL: its content is undefined until the whole frame is redrawn. */
+
+class StreamingTexture {
+
+  private:
+    SDL_Texture* textures[STREAMING_MAX_BUFFERS];
+    bool locked[STREAMING_MAX_BUFFERS];
+    int buffer_count;
+
+    int width;
+    int height;
+
+  public:
+    StreamingTexture  (SDL_Renderer* const renderer, int const width, int const height, int const buffers); // 'buffers': 1 or 2
+    ~StreamingTexture ();
+
+    StreamingTexture (StreamingTexture const &) = delete;
+    StreamingTexture& operator= (StreamingTexture const &) = delete;
+
+    bool is_valid () const;
+    int get_buffer_count () const;
+
+    bool lock (int const buffer, Pixmap &frame); // 'frame' wraps the memory until 'unlock'. False on failure (see SDL_GetError)
+    void unlock (int const buffer);              // 'frame' must not be drawn in anymore
+
+    SDL_Texture* get_texture (int const buffer) const;
+
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool (int const thread_count)
+{
+    int count = thread_count;
+    if (count <= 0) count = std::thread::hardware_concurrency();
+    if (count <= 0) count = 1;
+
+    job = nullptr;
+    job_count = job_chunks = 0;
+    generation = 0;
+    busy_workers = 0;
+    stopping = false;
+    next_chunk = finished_chunks = 0;
+
+    for (int i = 1; i < count; i++) // The calling thread is the last worker
+        workers.emplace_back (&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for (std::thread &t : workers)
+        t.join();
+}
+
+void ThreadPool::run_chunks ()
+{
+    for (int c = next_chunk++; c < job_chunks; c = next_chunk++)
+    {
+        // Chunk boundaries only depend on (count, chunks): the split is the same on every run
+        int const begin = (int) ((long long) job_count * c / job_chunks);
+        int const end   = (int) ((long long) job_count * (c + 1) / job_chunks);
+
+        (*job) (begin, end);
+
+        ++finished_chunks;
+    }
+}
+
+void ThreadPool::worker_loop ()
+{
+    unsigned long seen = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            wake.wait (lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (job == nullptr) continue; // Woke up after the job was already completed
+            ++busy_workers;
+        }
+
+        run_chunks();
+
+        std::lock_guard<std::mutex> lock (mutex);
+        if (--busy_workers == 0) done.notify_one();
+    }
+}
+
+void ThreadPool::parallel_for (int const count, int const chunks, std::function<void (int, int)> const &func)
+{
+
+    if (count <= 0) return;
+
+    bool posted = false;
+
+    if (!workers.empty() && chunks > 1)
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+
+        // One job at a time: called from a chunk of the current job, or from another thread while
+        // one runs, the loop runs on the calling thread instead
+        if (job == nullptr)
+        {
+            job = &func;
+            job_count  = count;
+            job_chunks = chunks < count ? chunks : count;
+            next_chunk = finished_chunks = 0;
+
+            ++generation;
+            posted = true;
+        }
+    }
+
+    if (!posted)
+    {
+        func (0, count);
+        return;
+    }
+
+    wake.notify_all();
+
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock (mutex);
+    // Also wait for every worker to leave 'run_chunks', so none of them can see the next job's state half-written
+    done.wait (lock, [&] { return finished_chunks == job_chunks && busy_workers == 0; });
+
+    job = nullptr;
+
+}
+
+int ThreadPool::get_thread_count () const
+{
+    return (int) workers.size() + 1;
+}
@@ -0,0 +1,62 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __THREADPOOL_HPP__
+#define __THREADPOOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fork-join pool used as an optional execution context by Pixmap (see 'Pixmap::set_executor').
+   'parallel_for' cuts [0, count) into 'chunks' contiguous ranges, runs them on the workers and
+   on the calling thread, and returns once all of them are done. The pool runs one job at a time:
+   a 'parallel_for' issued from inside a chunk, or from another thread while a job runs, is run
+   whole on its calling thread. */
+
+class ThreadPool {
+
+  private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;   // Signals workers that a new job is posted (or that the pool stops)
+    std::condition_variable done;   // Signals the caller that the last chunk is finished
+
+    std::function<void (int, int)> const* job;
+    int job_count;
+    int job_chunks;
+    unsigned long generation;       // Incremented for every posted job
+    int busy_workers;               // Workers that took the current job and have not left 'run_chunks' yet
+    bool stopping;
+
+    std::atomic<int> next_chunk;
+    std::atomic<int> finished_chunks;
+
+    void worker_loop ();
+    void run_chunks ();
+
+  public:
+    ThreadPool  (int const thread_count); // 0 = one thread per hardware core
+    ~ThreadPool ();
+
+    ThreadPool (ThreadPool const &) = delete;
+    ThreadPool& operator= (ThreadPool const &) = delete;
+
+    void parallel_for (int const count, int const chunks, std::function<void (int, int)> const &func);
+
+    int get_thread_count () const; // Workers + calling thread
+
+};
+
+#endif
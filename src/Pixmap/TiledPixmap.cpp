@@ -0,0 +1,265 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "TiledPixmap.hpp"
+#include "Blend.hpp"
+#include "ThreadPool.hpp"
+
+#define TILED_PARALLEL_MIN_PIXELS (256 * 256)
+
+TiledPixmap::TiledPixmap ()
+{
+    width = height = 0;
+    tile_log2 = TILE_LOG2_DEFAULT;
+    tile_size = 1 << tile_log2;
+    tiles_x = tiles_y = 0;
+    datas = nullptr;
+    format = PIXEL_STRAIGHT;
+    executor = nullptr;
+}
+
+TiledPixmap::TiledPixmap (int const width, int const height, int const tile_log2) : TiledPixmap ()
+{
+    resize (width, height, tile_log2);
+}
+
+TiledPixmap::TiledPixmap (Pixmap const &pix, int const tile_log2) : TiledPixmap ()
+{
+    this -> tile_log2 = tile_log2;
+    load (pix);
+}
+
+TiledPixmap::~TiledPixmap ()
+{
+    pixels_free (datas);
+}
+
+void TiledPixmap::resize (int const width, int const height, int const tile_log2)
+{
+
+    int const log2 = std::max (TILE_LOG2_MIN, std::min (tile_log2, TILE_LOG2_MAX));
+    int const size = 1 << log2;
+
+    int const new_tiles_x = (std::max (width, 0)  + size - 1) >> log2;
+    int const new_tiles_y = (std::max (height, 0) + size - 1) >> log2;
+
+    if ((size_t) new_tiles_x * new_tiles_y * size * size != (size_t) tiles_x * tiles_y * tile_size * tile_size || datas == nullptr)
+    {
+        pixels_free (datas);
+        datas = (new_tiles_x * new_tiles_y > 0) ? pixels_alloc (new_tiles_x * new_tiles_y * size * size) : nullptr;
+    }
+
+    this -> width  = width;
+    this -> height = height;
+    this -> tile_log2 = log2;
+    this -> tile_size = size;
+    this -> tiles_x = new_tiles_x;
+    this -> tiles_y = new_tiles_y;
+
+}
+
+void TiledPixmap::set_executor (ThreadPool* const pool)
+{
+    executor = pool;
+}
+
+void TiledPixmap::for_each_index (int const count, std::function<void (int)> const &job) const
+{
+
+    std::function<void (int, int)> const range = [&] (int const begin, int const end)
+    {
+        for (int i = begin; i < end; i++) job (i);
+    };
+
+    if (executor == nullptr || executor -> get_thread_count() < 2 || count < 2 || width * height < TILED_PARALLEL_MIN_PIXELS)
+        range (0, count);
+    else
+        executor -> parallel_for (count, count, range);
+
+}
+
+/* LINEAR CONVERSION */
+
+void TiledPixmap::load (Pixmap const &pix)
+{
+
+    resize (pix.get_width(), pix.get_height(), tile_log2);
+    format = pix.get_format();
+
+    pixel const* const src = pix.get_pixels();
+    int const src_stride = pix.get_stride();
+
+    // One column strip per job: contiguous writes, 'tile_size' pixels read from each source row
+    for_each_index (tiles_x, [&] (int const strip)
+    {
+        int const x1 = strip << tile_log2;
+        int const w  = std::min (tile_size, width - x1);
+
+        for (int y = 0; y < height; y++)
+            std::memcpy (get_pixel_adress (x1, y), src + y * src_stride + x1, w * sizeof (pixel));
+    });
+
+}
+
+void TiledPixmap::store (Pixmap &pix) const
+{
+
+    if (pix.get_width() != width || pix.get_height() != height) pix.resize (width, height, pix.has_alpha());
+
+    pixel* const dst = pix.get_pixels();
+    int const dst_stride = pix.get_stride();
+    PixelFormat const dst_format = pix.get_format();
+
+    for_each_index (tiles_x, [&] (int const strip)
+    {
+        int const x1 = strip << tile_log2;
+        int const w  = std::min (tile_size, width - x1);
+
+        for (int y = 0; y < height; y++)
+        {
+            pixel* const row = dst + y * dst_stride + x1;
+
+            if (dst_format == format)                  std::memcpy (row, get_pixel_adress (x1, y), w * sizeof (pixel));
+            else if (dst_format == PIXEL_PREMULTIPLIED) premultiply_span (get_pixel_adress (x1, y), row, w);
+            else                                        unpremultiply_span (get_pixel_adress (x1, y), row, w);
+        }
+    });
+
+}
+
+void TiledPixmap::blit_on_texture (SDL_Texture* const texture, int const x1, int const y1) const
+{
+
+    static thread_local std::vector<pixel> band;
+    band.resize ((size_t) width * tile_size);
+
+    for (int ty = 0; ty < tiles_y; ty++)
+    {
+        int const band_y = ty << tile_log2;
+        int const h = std::min (tile_size, height - band_y);
+
+        for (int y = 0; y < h; y++)
+        {
+            for (int strip = 0; strip < tiles_x; strip++)
+            {
+                int const x = strip << tile_log2;
+                std::memcpy (band.data() + (size_t) y * width + x, get_pixel_adress (x, band_y + y), std::min (tile_size, width - x) * sizeof (pixel));
+            }
+
+            // SDL textures hold straight ARGB
+            if (format == PIXEL_PREMULTIPLIED) unpremultiply_span (band.data() + (size_t) y * width, band.data() + (size_t) y * width, width);
+        }
+
+        SDL_Rect rect = {x1, y1 + band_y, width, h};
+        SDL_UpdateTexture (texture, &rect, band.data(), width * sizeof (Uint32));
+    }
+
+}
+
+/* TILES */
+
+int TiledPixmap::get_tile_count () const
+{
+    return tiles_x * tiles_y;
+}
+
+PixelTile TiledPixmap::get_tile (int const index) const
+{
+    int const tx = index / tiles_y;
+    int const ty = index % tiles_y;
+
+    PixelTile tile;
+    tile.x1 = tx << tile_log2;
+    tile.y1 = ty << tile_log2;
+    tile.width  = std::min (tile_size, width  - tile.x1);
+    tile.height = std::min (tile_size, height - tile.y1);
+    tile.stride = tile_size;
+    tile.datas  = datas + (size_t) index * tile_size * tile_size; // Same as 'get_pixel_adress (x1, y1)'
+
+    return tile;
+}
+
+void TiledPixmap::for_each_tile (std::function<void (PixelTile const &)> const &job) const
+{
+    for_each_index (get_tile_count(), [&] (int const index)
+    {
+        job (get_tile (index));
+    });
+}
+
+/* OPERATIONS */
+
+void TiledPixmap::rotate_90 (TiledPixmap &dst) const
+{
+
+    /* dst (x, y) = src (y, height - 1 - x): every destination tile comes from a single source
+       tile, read by columns while it sits in L1. */
+
+    dst.resize (height, width, tile_log2);
+    dst.format = format;
+
+    if (datas == nullptr) return;
+
+    dst.for_each_tile ([&] (PixelTile const &tile)
+    {
+        for (int y = 0; y < tile.height; y++)
+        {
+            pixel* d_ptr = tile.datas + y * tile.stride;
+            int const src_x = tile.y1 + y;
+
+            for (int x = 0; x < tile.width; x++)
+                d_ptr[x] = *get_pixel_adress (src_x, height - 1 - (tile.x1 + x));
+        }
+    });
+
+}
+
+/* ACCESS */
+
+pixel TiledPixmap::read_pixel (int const x, int const y) const
+{
+
+    #ifdef DEBUG
+        if ((x < 0) || (y < 0) || (x >= width) || (y >= height))
+        {
+            std::cout << "TiledPixmap::read_pixel > Pixel ' " << x << " : " << y << " ' is out of limit." << std::endl;
+            return 0;
+        }
+    #endif
+
+    return *get_pixel_adress (x, y);
+
+}
+
+void TiledPixmap::write_pixel (int const x, int const y, pixel const color)
+{
+
+    #ifdef DEBUG
+        if ((x < 0) || (y < 0) || (x >= width) || (y >= height))
+        {
+            std::cout << "TiledPixmap::write_pixel > Pixel ' " << x << " : " << y << " ' is out of limit." << std::endl;
+            return;
+        }
+    #endif
+
+    *get_pixel_adress (x, y) = color;
+
+}
+
+int TiledPixmap::get_width     () const { return width; }
+int TiledPixmap::get_height    () const { return height; }
+int TiledPixmap::get_tile_size () const { return tile_size; }
+
+PixelFormat TiledPixmap::get_format () const { return format; }
@@ -0,0 +1,94 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __TILEDPIXMAP_HPP__
+#define __TILEDPIXMAP_HPP__
+
+#include <functional>
+#include "Pixmap.hpp"
+
+#define TILE_LOG2_MIN     3 // 8x8
+#define TILE_LOG2_MAX     6 // 64x64
+#define TILE_LOG2_DEFAULT 6 // 16 KB per tile, a tile and its neighbours stay in L1/L2
+
+/* Pixels stored as square tiles of 2^tile_log2 pixels: a tile is one contiguous block, and the
+   tiles of a column follow each other, so a column strip (tile_size wide, full height) is
+   contiguous too. Vertical passes and rotations then walk memory a few hundred bytes at a
+   time instead of one image row per pixel. Edge tiles are padded, the padding is never read.
+   Conversion to / from the linear layout happens in 'load', 'store' and 'blit_on_texture'.
+   The pixels keep the format of the loaded pixmap (straight or premultiplied ARGB). */
+
+class ThreadPool;
+class SeparableKernel;
+
+struct PixelTile {
+
+  int x1; int y1;       // Position of the tile in the image
+  int width; int height; // Part of the tile inside the image (smaller on the right and bottom edges)
+  int stride;           // Pixels from one row of the tile to the next (the tile size)
+  pixel* datas;
+
+};
+
+class TiledPixmap {
+
+  private:
+    int width;
+    int height;
+    int tile_log2;
+    int tile_size;
+    int tiles_x;
+    int tiles_y;
+    pixel* datas;         // tiles_x strips of (tiles_y * tile_size) rows of tile_size pixels
+    PixelFormat format;   // Of the loaded pixmap
+    ThreadPool* executor; // Optional, not owned
+
+    void for_each_index (int const count, std::function<void (int)> const &job) const; // On 'executor' for large images
+
+  public:
+    TiledPixmap  ();
+    TiledPixmap  (int const width, int const height, int const tile_log2); // Content undefined
+    TiledPixmap  (Pixmap const &pix, int const tile_log2);                 // Converted from the linear layout
+    TiledPixmap  (TiledPixmap const &) = delete;
+    TiledPixmap& operator= (TiledPixmap const &) = delete;
+    ~TiledPixmap ();
+
+    void resize (int const width, int const height, int const tile_log2); // Content undefined afterwards
+    void set_executor (ThreadPool* const pool);
+
+    void load  (Pixmap const &pix);    // Resized to 'pix' (same tile size), takes its format
+    void store (Pixmap &pix) const;    // 'pix' resized to the image, converted to its format
+    void blit_on_texture (SDL_Texture* const texture, int const x1, int const y1) const; // One linear band per row of tiles, always straight ARGB
+
+    int get_tile_count () const;
+    PixelTile get_tile (int const index) const; // In memory order: down each column strip, then the next strip
+    void for_each_tile (std::function<void (PixelTile const &)> const &job) const; // Tiles in parallel on the executor
+
+    void vertical_convolve (SeparableKernel const &kernel, BorderMode const border); // Column pass of a separable filter
+    void rotate_90 (TiledPixmap &dst) const; // Clockwise, 'dst' resized (height x width, same tile size)
+
+    pixel* get_pixel_adress (int const x, int const y) const;
+    pixel read_pixel (int const x, int const y) const;
+    void write_pixel (int const x, int const y, pixel const color);
+
+    int get_width  () const;
+    int get_height () const;
+    int get_tile_size () const;
+    PixelFormat get_format () const;
+
+};
+
+inline pixel* TiledPixmap::get_pixel_adress (int const x, int const y) const
+{
+    int const strip = x >> tile_log2;
+    return datas + ((size_t) strip * tiles_y * tile_size + y) * tile_size + (x & (tile_size - 1));
+}
+
+#endif
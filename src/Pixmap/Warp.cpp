@@ -0,0 +1,381 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "Warp.hpp"
+#include "Composite.hpp"
+#include "Profile.hpp"
+
+#if defined (__x86_64__) || defined (__i386__)
+  #include <immintrin.h>
+  #define PIXMAP_X86
+#endif
+
+#define WARP_ONE  (1 << WARP_FRAC_BITS)
+#define WARP_HALF (1 << (WARP_FRAC_BITS - 1))
+
+/* AFFINE TRANSFORM */
+
+AffineTransform::AffineTransform () : AffineTransform (1.0, 0.0, 0.0, 0.0, 1.0, 0.0)
+{
+}
+
+AffineTransform::AffineTransform (double const xx, double const xy, double const tx, double const yx, double const yy, double const ty)
+{
+    this -> xx = xx; this -> xy = xy; this -> tx = tx;
+    this -> yx = yx; this -> yy = yy; this -> ty = ty;
+}
+
+AffineTransform AffineTransform::translation (double const tx, double const ty)
+{
+    return AffineTransform (1.0, 0.0, tx, 0.0, 1.0, ty);
+}
+
+AffineTransform AffineTransform::scaling (double const sx, double const sy)
+{
+    return AffineTransform (sx, 0.0, 0.0, 0.0, sy, 0.0);
+}
+
+AffineTransform AffineTransform::rotation (double const angle)
+{
+    double const c = cos (angle);
+    double const s = sin (angle);
+    return AffineTransform (c, -s, 0.0, s, c, 0.0);
+}
+
+AffineTransform AffineTransform::then (AffineTransform const &next) const
+{
+    return AffineTransform (next.xx * xx + next.xy * yx, next.xx * xy + next.xy * yy, next.xx * tx + next.xy * ty + next.tx,
+                            next.yx * xx + next.yy * yx, next.yx * xy + next.yy * yy, next.yx * tx + next.yy * ty + next.ty);
+}
+
+bool AffineTransform::invert (AffineTransform* const inverse) const
+{
+    double const det = xx * yy - xy * yx;
+    if (std::fabs (det) < 1e-12) return false;
+
+    double const ixx =  yy / det, ixy = -xy / det;
+    double const iyx = -yx / det, iyy =  xx / det;
+
+    *inverse = AffineTransform (ixx, ixy, -(ixx * tx + ixy * ty), iyx, iyy, -(iyx * tx + iyy * ty));
+    return true;
+}
+
+/* ROW CLIPPING */
+
+static int64_t floor_div (int64_t const a, int64_t const b) // b > 0
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static int64_t ceil_div (int64_t const a, int64_t const b) // b > 0
+{
+    return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+}
+
+// Narrows [*lo, *hi] to the x where 0 <= base + x * step < limit (exact, the sampling loops step the same way)
+static void clip_axis (int64_t const base, int64_t const step, int64_t const limit, int64_t* const lo, int64_t* const hi)
+{
+    if (step == 0)
+    {
+        if (base < 0 || base >= limit) *hi = *lo - 1;
+        return;
+    }
+
+    int64_t first, last;
+
+    if (step > 0) { first = ceil_div (-base, step);              last = floor_div (limit - 1 - base, step); }
+    else          { first = ceil_div (base - limit + 1, -step);  last = floor_div (base, -step); }
+
+    *lo = std::max (*lo, first);
+    *hi = std::min (*hi, last);
+}
+
+/* SAMPLING (SCALAR) */
+
+typedef void (*warp_row_fn) (pixel const* src, int stride, int w, int h, int64_t u, int64_t v, int64_t du, int64_t dv, pixel* dst, int n);
+
+static void sample_nearest_scalar (pixel const* const src, int const stride, int const, int const,
+                                   int64_t u, int64_t v, int64_t const du, int64_t const dv, pixel* const dst, int const n)
+{
+    for (int i = 0; i < n; i++, u += du, v += dv)
+        dst[i] = src[(v >> WARP_FRAC_BITS) * stride + (u >> WARP_FRAC_BITS)];
+}
+
+static inline pixel bilinear_sample (pixel const* const src, int const stride, int const w, int const h, int64_t const u, int64_t const v)
+{
+    // Relative to the pixel centres: the left / top neighbour and 8-bit weights
+    int64_t const uu = u - WARP_HALF;
+    int64_t const vv = v - WARP_HALF;
+
+    int const fu = (int) (uu >> (WARP_FRAC_BITS - 8)) & 0xFF;
+    int const fv = (int) (vv >> (WARP_FRAC_BITS - 8)) & 0xFF;
+
+    int x0 = (int) (uu >> WARP_FRAC_BITS), y0 = (int) (vv >> WARP_FRAC_BITS);
+    int const x1 = std::min (x0 + 1, w - 1), y1 = std::min (y0 + 1, h - 1);
+    x0 = std::max (x0, 0); y0 = std::max (y0, 0);
+
+    pixel const p00 = src[y0 * stride + x0], p01 = src[y0 * stride + x1];
+    pixel const p10 = src[y1 * stride + x0], p11 = src[y1 * stride + x1];
+
+    pixel out = 0;
+
+    for (int s = 0; s < 32; s += 8)
+    {
+        int const top    = ((p00 >> s) & 0xFF) * (256 - fu) + ((p01 >> s) & 0xFF) * fu;
+        int const bottom = ((p10 >> s) & 0xFF) * (256 - fu) + ((p11 >> s) & 0xFF) * fu;
+        out |= (pixel) ((top * (256 - fv) + bottom * fv + 32768) >> 16) << s;
+    }
+
+    return out;
+}
+
+static void sample_bilinear_scalar (pixel const* const src, int const stride, int const w, int const h,
+                                    int64_t u, int64_t v, int64_t const du, int64_t const dv, pixel* const dst, int const n)
+{
+    for (int i = 0; i < n; i++, u += du, v += dv)
+        dst[i] = bilinear_sample (src, stride, w, h, u, v);
+}
+
+#ifdef PIXMAP_X86
+
+/* SAMPLING (AVX2) */
+
+// Inside a clipped row every coordinate fits in 32 bits when the source is under 32768 pixels wide and
+// high ('blit_transformed' checks it), so the lanes step with wrapping 32-bit adds.
+// Nearest sampling stays scalar: one load per pixel, which an 8-lane gather does not beat.
+
+__attribute__ ((target ("avx2")))
+static inline __m256i lane_coordinates (int64_t const c, int64_t const dc)
+{
+    return _mm256_setr_epi32 ((int) c,          (int) (c + dc),     (int) (c + 2 * dc), (int) (c + 3 * dc),
+                              (int) (c + 4 * dc), (int) (c + 5 * dc), (int) (c + 6 * dc), (int) (c + 7 * dc));
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i bilinear_channel_avx2 (__m256i const p00, __m256i const p01, __m256i const p10, __m256i const p11,
+                                             __m256i const wu, __m256i const wv0, __m256i const wv1, int const s)
+{
+    __m128i const shift = _mm_cvtsi32_si128 (s);
+    __m256i const mask  = _mm256_set1_epi32 (0xFF);
+
+    // Left in the low 16 bits, right in the high ones: one madd gives left * (256 - fu) + right * fu
+    __m256i const top    = _mm256_madd_epi16 (_mm256_or_si256 (_mm256_and_si256 (_mm256_srl_epi32 (p00, shift), mask),
+                                                               _mm256_slli_epi32 (_mm256_and_si256 (_mm256_srl_epi32 (p01, shift), mask), 16)), wu);
+    __m256i const bottom = _mm256_madd_epi16 (_mm256_or_si256 (_mm256_and_si256 (_mm256_srl_epi32 (p10, shift), mask),
+                                                               _mm256_slli_epi32 (_mm256_and_si256 (_mm256_srl_epi32 (p11, shift), mask), 16)), wu);
+
+    __m256i const sum = _mm256_add_epi32 (_mm256_add_epi32 (_mm256_mullo_epi32 (top, wv0), _mm256_mullo_epi32 (bottom, wv1)),
+                                          _mm256_set1_epi32 (32768));
+
+    return _mm256_sll_epi32 (_mm256_srli_epi32 (sum, 16), shift);
+}
+
+__attribute__ ((target ("avx2")))
+static void sample_bilinear_avx2 (pixel const* const src, int const stride, int const w, int const h,
+                                  int64_t u, int64_t v, int64_t const du, int64_t const dv, pixel* const dst, int const n)
+{
+    __m256i const vstride = _mm256_set1_epi32 (stride);
+    __m256i const zero    = _mm256_setzero_si256();
+    __m256i const one     = _mm256_set1_epi32 (1);
+    __m256i const last_x  = _mm256_set1_epi32 (w - 1);
+    __m256i const last_y  = _mm256_set1_epi32 (h - 1);
+    __m256i const frac    = _mm256_set1_epi32 (0xFF);
+    __m256i const full    = _mm256_set1_epi32 (256);
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8, u += 8 * du, v += 8 * dv)
+    {
+        __m256i const uu = lane_coordinates (u - WARP_HALF, du);
+        __m256i const vv = lane_coordinates (v - WARP_HALF, dv);
+
+        __m256i const fu = _mm256_and_si256 (_mm256_srli_epi32 (uu, WARP_FRAC_BITS - 8), frac);
+        __m256i const fv = _mm256_and_si256 (_mm256_srli_epi32 (vv, WARP_FRAC_BITS - 8), frac);
+
+        __m256i const x = _mm256_srai_epi32 (uu, WARP_FRAC_BITS);
+        __m256i const y = _mm256_srai_epi32 (vv, WARP_FRAC_BITS);
+
+        __m256i const x0 = _mm256_max_epi32 (x, zero), x1 = _mm256_min_epi32 (_mm256_add_epi32 (x, one), last_x);
+        __m256i const y0 = _mm256_max_epi32 (y, zero), y1 = _mm256_min_epi32 (_mm256_add_epi32 (y, one), last_y);
+
+        __m256i const row0 = _mm256_mullo_epi32 (y0, vstride);
+        __m256i const row1 = _mm256_mullo_epi32 (y1, vstride);
+
+        __m256i const p00 = _mm256_i32gather_epi32 ((int const*) src, _mm256_add_epi32 (row0, x0), 4);
+        __m256i const p01 = _mm256_i32gather_epi32 ((int const*) src, _mm256_add_epi32 (row0, x1), 4);
+        __m256i const p10 = _mm256_i32gather_epi32 ((int const*) src, _mm256_add_epi32 (row1, x0), 4);
+        __m256i const p11 = _mm256_i32gather_epi32 ((int const*) src, _mm256_add_epi32 (row1, x1), 4);
+
+        __m256i const wu  = _mm256_or_si256 (_mm256_sub_epi32 (full, fu), _mm256_slli_epi32 (fu, 16));
+        __m256i const wv0 = _mm256_sub_epi32 (full, fv);
+
+        __m256i out = bilinear_channel_avx2 (p00, p01, p10, p11, wu, wv0, fv, 0);
+        out = _mm256_or_si256 (out, bilinear_channel_avx2 (p00, p01, p10, p11, wu, wv0, fv, 8));
+        out = _mm256_or_si256 (out, bilinear_channel_avx2 (p00, p01, p10, p11, wu, wv0, fv, 16));
+        out = _mm256_or_si256 (out, bilinear_channel_avx2 (p00, p01, p10, p11, wu, wv0, fv, 24));
+
+        _mm256_storeu_si256 ((__m256i*) (dst + i), out);
+    }
+
+    sample_bilinear_scalar (src, stride, w, h, u, v, du, dv, dst + i, n - i);
+}
+
+#endif
+
+/* RUNTIME DISPATCH */
+
+static warp_row_fn select_sample_bilinear ()
+{
+    #ifdef PIXMAP_X86
+        if (__builtin_cpu_supports ("avx2")) return sample_bilinear_avx2;
+    #endif
+    return sample_bilinear_scalar;
+}
+
+/* PIXMAP DRAWING */
+
+struct WarpRow {
+    int y;
+    int x;       // First target pixel
+    int n;
+    int64_t u;   // Source coordinates of the first pixel centre (WARP_FRAC_BITS)
+    int64_t v;
+};
+
+Rectbox Pixmap::blit_transformed (Pixmap &pix, AffineTransform const &transform, SampleMode const mode) const
+{
+    return blit_transformed (pix, transform, mode, nullptr);
+}
+
+Rectbox Pixmap::blit_transformed (Pixmap &pix, AffineTransform const &transform, SampleMode const mode, RowDisplacement const &displacement) const
+{
+
+    static warp_row_fn const sample_bilinear = select_sample_bilinear();
+
+    Rectbox area; // All -1: nothing drawn
+
+    AffineTransform inverse;
+    if (datas == nullptr || width <= 0 || height <= 0 || pix.datas == nullptr || !transform.invert (&inverse)) return area;
+
+    // Target rows that can reach the source: the displacement only moves rows sideways
+    double y_min = transform.ty, y_max = transform.ty;
+
+    for (int corner = 1; corner < 4; corner++)
+    {
+        double const cx = (corner & 1) ? width : 0;
+        double const cy = (corner & 2) ? height : 0;
+        double const y  = transform.yx * cx + transform.yy * cy + transform.ty;
+
+        y_min = std::min (y_min, y);
+        y_max = std::max (y_max, y);
+    }
+
+    // Clamped in double: far away transforms give rows outside the int range
+    int const first_row = (int) std::min (std::max (0.0, std::floor (y_min) - 1.0), (double) pix.height);
+    int const last_row  = (int) std::max (std::min ((double) pix.height - 1, std::ceil (y_max) + 1.0), -1.0);
+
+    int64_t const du = llround (inverse.xx * WARP_ONE);
+    int64_t const dv = llround (inverse.yx * WARP_ONE);
+
+    // Every row is mapped and clipped once, then only the visible pixels are sampled
+    std::vector<WarpRow> rows;
+
+    #ifdef PIXMAP_PROFILE
+        long long pixels = 0;
+    #endif
+
+    for (int y = first_row; y <= last_row; y++)
+    {
+
+        double const shift = displacement ? displacement (y) / (double) WARP_ONE : 0.0;
+        double const cx = 0.5 - shift;
+        double const cy = y + 0.5;
+
+        int64_t const u = llround ((inverse.xx * cx + inverse.xy * cy + inverse.tx) * WARP_ONE);
+        int64_t const v = llround ((inverse.yx * cx + inverse.yy * cy + inverse.ty) * WARP_ONE);
+
+        int64_t lo = 0, hi = pix.width - 1;
+        clip_axis (u, du, (int64_t) width  << WARP_FRAC_BITS, &lo, &hi);
+        clip_axis (v, dv, (int64_t) height << WARP_FRAC_BITS, &lo, &hi);
+
+        if (lo > hi) continue;
+
+        rows.push_back ({y, (int) lo, (int) (hi - lo + 1), u + lo * du, v + lo * dv});
+
+        #ifdef PIXMAP_PROFILE
+            pixels += hi - lo + 1;
+        #endif
+
+        if (area.y1 < 0) area.setter ((int) lo, y, (int) hi, y);
+        else             area.setter (std::min (area.x1, (int) lo), area.y1, std::max (area.x2, (int) hi), y);
+
+    }
+
+    if (rows.empty()) return area;
+
+    PIXMAP_PROFILE_SCOPE (PROFILE_BLIT_TRANSFORMED, pixels, pixels * sizeof (pixel));
+
+    pix.add_damage (area);
+
+    // 1:1 rows on whole source pixels (translations, wave offsets) are plain row blits
+    bool const unit_step = du == WARP_ONE && dv == 0;
+
+    // The SIMD lanes hold source coordinates in 32 bits: sources of 32768 pixels or more use the scalar sampler
+    bool const lanes_fit = ((int64_t) std::max (width, height) << WARP_FRAC_BITS) <= INT32_MAX;
+
+    warp_row_fn const sample = (mode != SAMPLE_BILINEAR) ? sample_nearest_scalar : lanes_fit ? sample_bilinear : sample_bilinear_scalar;
+
+    pix.for_each_band ((int) rows.size(), area.x2 - area.x1 + 1, [&] (int const band_begin, int const band_end)
+    {
+
+        static thread_local std::vector<pixel> samples;
+
+        for (int r = band_begin; r < band_end; r++)
+        {
+
+            WarpRow const &row = rows[r];
+            pixel* const target = pix.datas + row.y * pix.stride + row.x;
+            pixel const* source;
+
+            bool const centred = ((row.u - WARP_HALF) & (WARP_ONE - 1)) == 0 && ((row.v - WARP_HALF) & (WARP_ONE - 1)) == 0;
+
+            if (unit_step && (mode == SAMPLE_NEAREST || centred))
+            {
+                source = datas + (row.v >> WARP_FRAC_BITS) * stride + (row.u >> WARP_FRAC_BITS);
+            }
+            else if (!with_alpha)
+            {
+                sample (datas, stride, width, height, row.u, row.v, du, dv, target, row.n); // Opaque: straight into the target
+                continue;
+            }
+            else
+            {
+                samples.resize (row.n);
+                sample (datas, stride, width, height, row.u, row.v, du, dv, samples.data(), row.n);
+                source = samples.data();
+            }
+
+            // Like 'blit_line': opaque sources are copied as they are, the others blended in the target format
+            if (!with_alpha) std::memcpy (target, source, row.n * sizeof (pixel));
+            else             composite_span (source, format, target, span_format (pix.format), BLEND_OVER, row.n);
+
+        }
+
+    });
+
+    return area;
+
+}
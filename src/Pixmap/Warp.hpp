@@ -0,0 +1,46 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __WARP_HPP__
+#define __WARP_HPP__
+
+#include "Pixmap.hpp"
+
+/* Transformed blits ('Pixmap::blit_transformed'). Each target row is mapped back into the source
+   once: the source coordinates then step by a constant 16.16 fixed-point increment per pixel, and
+   the first and last target pixels whose sample falls inside the source are solved exactly from
+   that increment, so the inner loops never test bounds. Bilinear samples are computed 8 at a
+   time with AVX2 when available, bit-identical to the scalar path.
+   A row displacement (RowDisplacement) shifts whole target rows horizontally, which covers wave
+   effects; a row mapped 1:1 onto a whole source pixel is copied like 'blit_line'. */
+
+#define WARP_FRAC_BITS 16 // Fractional bits of the source coordinates
+
+struct AffineTransform {
+
+  // Source to target, in pixel-edge coordinates (the centre of pixel (0, 0) is (0.5, 0.5)):
+  // x' = xx * x + xy * y + tx
+  // y' = yx * x + yy * y + ty
+  double xx; double xy; double tx;
+  double yx; double yy; double ty;
+
+  AffineTransform (); // Identity
+  AffineTransform (double const xx, double const xy, double const tx, double const yx, double const yy, double const ty);
+
+  static AffineTransform translation (double const tx, double const ty);
+  static AffineTransform scaling (double const sx, double const sy);
+  static AffineTransform rotation (double const angle); // Radians, clockwise on screen (y goes down)
+
+  AffineTransform then (AffineTransform const &next) const; // This transform first, then 'next'
+  bool invert (AffineTransform* const inverse) const;       // False when singular (nothing can be drawn)
+
+};
+
+#endif
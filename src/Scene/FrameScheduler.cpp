@@ -0,0 +1,157 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <SDL2/SDL.h>
+
+#include "FrameScheduler.hpp"
+
+static double to_ms (FrameClock::duration const duration)
+{
+    return std::chrono::duration<double, std::milli> (duration).count();
+}
+
+FrameScheduler::FrameScheduler (Pixmap const &first, FrameRenderer const &renderer, double const fps)
+    : FrameScheduler (std::vector<Pixmap> (FRAME_BUFFERS, first), renderer, fps)
+{
+}
+
+FrameScheduler::FrameScheduler (std::vector<Pixmap> &&buffers, FrameRenderer const &renderer, double const fps)
+{
+    this -> buffers = std::move (buffers);
+    this -> buffers.resize (FRAME_BUFFERS); // Missing buffers are empty pixmaps
+    this -> renderer = renderer;
+    this -> stopping = false;
+    this -> next_render = 0;
+    this -> next_index = 0;
+    this -> next_present = 0;
+
+    for (int b = 0; b < FRAME_BUFFERS; b++) rendered[b] = false;
+
+    if (fps > 0) period = std::chrono::duration_cast<FrameClock::duration> (std::chrono::duration<double> (1.0 / fps));
+    else         period = FrameClock::duration::zero();
+
+    deadline = FrameClock::now();
+
+    worker = std::thread (&FrameScheduler::worker_loop, this);
+}
+
+FrameScheduler::~FrameScheduler ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        stopping = true;
+    }
+
+    changed.notify_all();
+    worker.join(); // The frame being rasterized is finished first
+}
+
+void FrameScheduler::worker_loop ()
+{
+    std::unique_lock<std::mutex> lock (mutex);
+
+    while (true)
+    {
+        int const b = next_render;
+
+        changed.wait (lock, [&] { return stopping || !rendered[b]; });
+        if (stopping) return;
+
+        unsigned long const index = next_index++;
+        started[b] = FrameClock::now();
+
+        lock.unlock();
+        renderer (buffers[b], b, index); // The calling thread only touches the other buffers meanwhile
+        lock.lock();
+
+        rendered[b] = true;
+        next_render = (b + 1) % FRAME_BUFFERS;
+
+        changed.notify_all();
+    }
+}
+
+Pixmap& FrameScheduler::acquire (int* const buffer)
+{
+    std::unique_lock<std::mutex> lock (mutex);
+
+    int const b = next_present;
+    changed.wait (lock, [&] { return rendered[b]; });
+
+    presenting_start = started[b];
+    if (buffer != nullptr) *buffer = b;
+
+    return buffers[b];
+}
+
+void FrameScheduler::release ()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+
+        rendered[next_present] = false;
+        next_present = (next_present + 1) % FRAME_BUFFERS;
+    }
+
+    changed.notify_all();
+}
+
+void FrameScheduler::frame_presented ()
+{
+    FrameClock::time_point const now = FrameClock::now();
+
+    if (!latencies.empty()) intervals.push_back (to_ms (now - last_present));
+
+    latencies.push_back (to_ms (now - presenting_start));
+    last_present = now;
+
+    if (period == FrameClock::duration::zero()) return;
+
+    // The deadlines stay on a fixed grid: a frame that took longer only shortens its own sleep
+    deadline += period;
+    if (deadline < now) deadline = now; // Already late: start a new grid rather than rushing the next frames
+
+    std::this_thread::sleep_until (deadline);
+}
+
+FrameStats FrameScheduler::get_stats () const
+{
+    FrameStats stats = {};
+
+    stats.frames = latencies.size();
+    if (latencies.empty()) return stats;
+
+    std::vector<double> sorted (latencies);
+    std::sort (sorted.begin(), sorted.end());
+
+    double latency_sum = 0;
+    for (double const latency : sorted) latency_sum += latency;
+
+    stats.latency_mean_ms = latency_sum / sorted.size();
+    stats.latency_p99_ms = sorted[std::min (sorted.size() - 1, (size_t) std::ceil (sorted.size() * 0.99) - 1)];
+    stats.latency_max_ms = sorted.back();
+
+    if (intervals.empty()) return stats;
+
+    double interval_sum = 0;
+    for (double const interval : intervals) interval_sum += interval;
+
+    double const mean = interval_sum / intervals.size();
+    double deviation = 0;
+    for (double const interval : intervals) deviation += (interval - mean) * (interval - mean);
+
+    stats.interval_mean_ms = mean;
+    stats.jitter_ms = std::sqrt (deviation / intervals.size());
+    stats.fps = 1000.0 / mean;
+
+    return stats;
+}
@@ -0,0 +1,96 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __FRAMESCHEDULER_HPP__
+#define __FRAMESCHEDULER_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Pixmap/Pixmap.hpp"
+
+/* Double-buffered frame loop: a worker thread rasterizes frame N+1 into one Pixmap while the
+   calling (SDL) thread uploads and presents frame N from the other one.
+   Each frame of the calling thread is: 'acquire' (waits for the next rasterized frame), upload,
+   'release' (hands the buffer back to the worker), draw the rest and present, then
+   'frame_presented', which records the timings and sleeps until the next frame is due.
+   The sleep is measured against a fixed deadline grid, so the time spent by the frame itself is
+   not added on top of the period. A frame rate of 0 disables the pacing (headless runs).
+   Between 'acquire' and 'release' the acquired buffer belongs to the calling thread, which may
+   also replace it (e.g. by the memory of a texture locked again): the worker draws in the new one. */
+
+#define FRAME_BUFFERS 2
+
+typedef std::chrono::steady_clock FrameClock;
+
+// Rasterizes frame 'index' into 'frame' (worker thread). 'buffer' tells which of the buffers it is:
+// its content is the frame rasterized FRAME_BUFFERS frames earlier
+typedef std::function<void (Pixmap &frame, int const buffer, unsigned long const index)> FrameRenderer;
+
+struct FrameStats {
+    unsigned long frames;
+    double fps;              // Presented frames per second (from the mean interval)
+    double latency_mean_ms;  // From the start of the rasterization to the end of the present
+    double latency_p99_ms;
+    double latency_max_ms;
+    double interval_mean_ms; // Between two presents
+    double jitter_ms;        // Standard deviation of the interval
+};
+
+class FrameScheduler {
+
+  private:
+    std::vector<Pixmap> buffers;
+    bool rendered[FRAME_BUFFERS];                // Rasterized, not released by the calling thread yet
+    FrameClock::time_point started[FRAME_BUFFERS]; // Start of the rasterization of its current frame
+
+    FrameRenderer renderer;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable changed; // A buffer was rasterized or released (or the scheduler stops)
+    bool stopping;
+
+    int next_render;  // Buffer the worker fills next
+    unsigned long next_index; // Frame the worker rasterizes next
+    int next_present; // Buffer the calling thread takes next
+    FrameClock::time_point presenting_start; // 'started' of the acquired frame
+
+    FrameClock::duration period; // Zero: not paced
+    FrameClock::time_point deadline;
+    FrameClock::time_point last_present;
+
+    std::vector<double> latencies; // ms
+    std::vector<double> intervals; // ms
+
+    void worker_loop ();
+
+  public:
+    // Every buffer starts as a copy of 'first' (content, format, executor, damage tracking, fully damaged if tracked)
+    FrameScheduler (Pixmap const &first, FrameRenderer const &renderer, double const fps);
+    // The FRAME_BUFFERS pixmaps of 'buffers' are taken as they are (e.g. wrapping locked streaming textures)
+    FrameScheduler (std::vector<Pixmap> &&buffers, FrameRenderer const &renderer, double const fps);
+    ~FrameScheduler ();
+
+    FrameScheduler (FrameScheduler const &) = delete;
+    FrameScheduler& operator= (FrameScheduler const &) = delete;
+
+    Pixmap& acquire (int* const buffer = nullptr); // Blocks until the next frame is rasterized, 'buffer' gets its index
+    void release ();         // The acquired frame is uploaded: the worker may draw in it again
+    void frame_presented (); // Records the latency and the interval, then waits for the next deadline
+
+    FrameStats get_stats () const;
+
+};
+
+#endif
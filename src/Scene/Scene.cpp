@@ -0,0 +1,140 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <cmath>
+#include <SDL2/SDL.h>
+#include "Scene.hpp"
+#include "../Pixmap/DrawList.hpp"
+#include "../Pixmap/Warp.hpp"
+
+/* WAVE WARP */
+
+WaveWarp::WaveWarp ()
+{
+    int const size = 1 << WAVE_LUT_BITS;
+
+    for (int i = 0; i < size; i++)
+        sine_lut[i] = (int) lround (sin (2.0 * M_PI * i / size) * 65536.0);
+}
+
+Rectbox WaveWarp::blit (Pixmap const &src, Pixmap &target, int const target_x1, int const target_y1,
+                        int const amplitude_x, float const phase, float const ripple_rate, bool const subpixel) const
+{
+
+   /* amplitude_x: ripple distance   */
+   /* phase: ripple speed/frequency  */
+   /* ripple_rate: ripple count/rate */
+
+    int const src_height = src.get_height();
+    int const src_width  = src.get_width();
+
+    // Angles as 32-bit fractions of a turn: the accumulator wraps exactly like the sine does
+    double const turn = 4294967296.0 / (2.0 * M_PI);
+    uint32_t angle = (uint32_t) (int64_t) llround (fmod ((double) phase, 2.0 * M_PI) * turn);
+    uint32_t const angle_step = (uint32_t) (int64_t) llround (fmod ((double) ripple_rate, 2.0 * M_PI) * turn);
+
+    if (!subpixel)
+    {
+        // Whole-pixel offsets: a translation with one displacement per row, each row is a plain row blit
+        uint32_t const first_angle = angle;
+
+        RowDisplacement const wave = [&] (int const y)
+        {
+            uint32_t const row_angle = first_angle + (uint32_t) (y - target_y1) * angle_step;
+            int64_t const x_fx = (int64_t) target_x1 * 65536 - (int64_t) amplitude_x * sine_lut[row_angle >> (32 - WAVE_LUT_BITS)];
+            return (int) (((x_fx >> 16) - target_x1) * 65536);
+        };
+
+        return src.blit_transformed (target, AffineTransform::translation (target_x1, target_y1), SAMPLE_NEAREST, wave);
+    }
+
+    Rectbox area (target_x1, target_y1, target_x1, target_y1 + src_height - 1);
+
+    for (int y = 0; y < src_height; y++, angle += angle_step)
+    {
+
+        int64_t const offset_fx = (int64_t) amplitude_x * sine_lut[angle >> (32 - WAVE_LUT_BITS)];
+        int64_t const x_fx = (int64_t) target_x1 * 65536 - offset_fx;
+
+        int const x = (int) (x_fx >> 16);
+        int last = x + src_width - 1;
+
+        if (x_fx & 0xFFFF)
+        {
+            src.blit_line_subpixel (target, y, x_fx, target_y1 + y); // 64 bits: an int 16.16 overflows from x = 32768
+            ++last;
+        }
+        else src.blit_line (target, y, x, target_y1 + y);
+
+        if (x < area.x1) area.x1 = x;
+        if (last > area.x2) area.x2 = last;
+
+    }
+
+    return area;
+
+}
+
+Rectbox blit_sin (Pixmap const &src, Pixmap &target, int const target_x1, int const target_y1, int const amplitude_x, float const phase, float const ripple_rate)
+{
+    static WaveWarp const warp;
+    return warp.blit (src, target, target_x1, target_y1, amplitude_x, phase, ripple_rate, false);
+}
+
+void draw_french_flag (Pixmap &pix)
+{
+    int const third_of_the_flag = pix.get_width() / 3;
+    int const pix_height = pix.get_height() - 1;
+
+    DrawList list; // The shared edge columns are written once, by the stripe drawn last
+
+    for (int i = 0; i < 3; i++)
+    {
+
+        Rectbox rect (third_of_the_flag * i, 0, third_of_the_flag * (i+1), pix_height);
+
+        pixel colour;
+        if      (i == 0) colour = 0xFF0050A4;
+        else if (i == 1) colour = 0xFFFFFFFF;
+        else    {        colour = 0xFFEF4135; rect.x2 += 1;}
+
+        list.add_rect (rect, colour);
+
+    }
+
+    list.execute (pix);
+}
+
+void draw_checkerboard (Pixmap &pix, int const side_length)
+{
+    int const pix_width  = pix.get_width()  / side_length;
+    int const pix_height = pix.get_height() / side_length;
+
+    DrawList list; // Recorded, then drawn one scanline at a time with the touching same-colour cells merged
+
+    for (int y = 0; y < pix_height; y++)
+    {
+        for (int x = 0; x < pix_width; x++)
+        {
+
+            pixel colour;
+            if (x % 2 == y % 2) colour = 0xFFFFFFFF;
+            else                colour = 0xFF000000;
+
+            int x1 = x * side_length; int y1 = y * side_length;
+            Rectbox rect (x1, y1, x1 + side_length - 1, y1 + side_length - 1);
+
+            list.add_rect (rect, colour);
+
+        }
+    }
+
+    list.execute (pix);
+}
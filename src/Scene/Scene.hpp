@@ -0,0 +1,45 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __SCENE_HPP__
+#define __SCENE_HPP__
+
+#include "../Pixmap/Pixmap.hpp"
+
+/* Drawing steps of the wave demo, shared by the interactive program and the benchmarks */
+
+#define WAVE_LUT_BITS 12 // 4096 sine samples per period
+
+/* Wave warp: each source row is shifted horizontally by 'amplitude_x * sin (y * ripple_rate + phase)'.
+   The sine comes from a fixed-point table walked with a 32-bit phase accumulator (no trig per row),
+   every row is clipped against 'target' once, and copied with memcpy (opaque source) or blended.
+   Whole-pixel offsets go through 'Pixmap::blit_transformed' with one displacement per row.
+   With 'subpixel', the fractional part of the offset is kept and rows are linearly filtered. */
+
+class WaveWarp {
+
+  private:
+    int sine_lut[1 << WAVE_LUT_BITS]; // sin() in 16.16 fixed point
+
+  public:
+    WaveWarp ();
+
+    // Returns an area of 'target' containing every written pixel (clipped without 'subpixel')
+    Rectbox blit (Pixmap const &src, Pixmap &target, int const target_x1, int const target_y1,
+                  int const amplitude_x, float const phase, float const ripple_rate, bool const subpixel) const;
+
+};
+
+Rectbox blit_sin (Pixmap const &src, Pixmap &target, int const target_x1, int const target_y1, int const amplitude_x, float const phase, float const ripple_rate); // WaveWarp, whole pixels
+
+void draw_french_flag (Pixmap &pix);
+void draw_checkerboard (Pixmap &pix, int const side_length);
+
+#endif
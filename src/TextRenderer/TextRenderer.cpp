@@ -0,0 +1,112 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#include <iostream>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "TextRenderer.hpp"
+
+bool TextRenderer::TextKey::operator< (TextKey const &k) const
+{
+    if (font != k.font) return font < k.font;
+    if (rgb  != k.rgb)  return rgb  < k.rgb;
+    return text < k.text;
+}
+
+TextRenderer::TextRenderer (SDL_Renderer* const renderer)
+{
+    this -> renderer = renderer;
+    this -> frame = 0;
+}
+
+TextRenderer::~TextRenderer ()
+{
+    for (auto const &t : texts)
+        SDL_DestroyTexture (t.second.texture);
+
+    for (auto const &f : fonts)
+        if (f.second) TTF_CloseFont (f.second);
+}
+
+TTF_Font* TextRenderer::get_font (const char* const font_path, int const size)
+{
+
+    FontKey const key (font_path, size);
+
+    auto const it = fonts.find (key);
+    if (it != fonts.end()) return it -> second;
+
+    TTF_Font* font = TTF_OpenFont (font_path, size);
+
+    if (!font) std::cerr << "ERROR: " << TTF_GetError() << std::endl;
+
+    fonts[key] = font; // A failure is cached too, the file is not opened again every frame
+
+    return font;
+
+}
+
+void TextRenderer::draw (const char* const font_path, const char* const text,
+                         int const size, int const x, int const y, int const w, int const h,
+                         uint8_t const r, uint8_t const g, uint8_t const b, uint8_t const a)
+{
+
+    TTF_Font* font = get_font (font_path, size);
+    if (!font) return;
+
+    TextKey const key = {font, text, (Uint32) ((r << 16) | (g << 8) | b)};
+
+    auto it = texts.find (key);
+
+    if (it == texts.end()) // Rasterized only the first time this text is seen
+    {
+
+        const SDL_Color text_color = {r, g, b, 255};
+
+        SDL_Surface* text_surface = TTF_RenderText_Blended (font, text, text_color);
+        if (!text_surface) { std::cerr << "ERROR: " << TTF_GetError() << std::endl; return; }
+
+        SDL_Texture* text_texture = SDL_CreateTextureFromSurface (renderer, text_surface);
+        SDL_FreeSurface (text_surface);
+
+        if (!text_texture) { std::cerr << "ERROR: " << SDL_GetError() << std::endl; return; }
+
+        it = texts.insert ({key, {text_texture, frame}}).first;
+
+    }
+
+    it -> second.last_frame = frame;
+
+    const SDL_Rect text_location = {x, y, w, h};
+
+    SDL_SetTextureAlphaMod (it -> second.texture, a); // The alpha is not part of the key
+    SDL_RenderCopy (renderer, it -> second.texture, NULL, &text_location);
+
+}
+
+void TextRenderer::end_frame ()
+{
+    for (auto it = texts.begin(); it != texts.end(); )
+    {
+        if (it -> second.last_frame != frame)
+        {
+            SDL_DestroyTexture (it -> second.texture);
+            it = texts.erase (it);
+        }
+        else ++it;
+    }
+
+    ++frame;
+}
+
+int TextRenderer::get_cached_count () const
+{
+    return (int) texts.size();
+}
@@ -0,0 +1,66 @@
+/*
+
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+
+    Version file: 01
+    Date: 30/07/2022
+
+*/
+
+#ifndef __TEXTRENDERER_HPP__
+#define __TEXTRENDERER_HPP__
+
+#include <map>
+#include <string>
+#include <utility>
+
+/* Cached text drawing: fonts stay open per (path, size) and every rendered string is kept as a
+   texture keyed by (font, text, colour), so a label is only rasterized again when it changes.
+   Textures that were not drawn during the last frame are freed by 'end_frame'.
+   Must be destroyed before its renderer and before TTF_Quit. */
+
+class TextRenderer {
+
+  private:
+    typedef std::pair<std::string, int> FontKey; // Path, point size
+
+    struct TextKey {
+        TTF_Font* font;
+        std::string text;
+        Uint32 rgb;
+        bool operator< (TextKey const &k) const;
+    };
+
+    struct TextEntry {
+        SDL_Texture* texture;
+        unsigned long last_frame; // Last frame the text was drawn in
+    };
+
+    SDL_Renderer* renderer;
+
+    std::map<FontKey, TTF_Font*> fonts;
+    std::map<TextKey, TextEntry> texts;
+
+    unsigned long frame;
+
+    TTF_Font* get_font (const char* const font_path, int const size);
+
+  public:
+    TextRenderer  (SDL_Renderer* const renderer);
+    ~TextRenderer ();
+
+    TextRenderer (TextRenderer const &) = delete;
+    TextRenderer& operator= (TextRenderer const &) = delete;
+
+    void draw (const char* const font_path, const char* const text,
+               int const size, int const x, int const y, int const w, int const h,
+               uint8_t const r, uint8_t const g, uint8_t const b, uint8_t const a);
+
+    void end_frame (); // Frees the texts that were not drawn since the previous call
+
+    int get_cached_count () const;
+
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*
+    Title: French Pixmap - thread scaling benchmark
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+    Version file: 01
+    Date: 30/07/2022
+*/
+
+/* Times the whole-image operations on a 4K pixmap with 1 to N threads.       */
+/* USAGE: ./bench_threads [max_threads] [repetitions]                         */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <SDL2/SDL.h>
+
+#include "../Pixmap/Pixmap.hpp"
+#include "../Pixmap/ThreadPool.hpp"
+
+#define BENCH_W 3840
+#define BENCH_H 2160
+
+template <typename F>
+double best_time_ms (int const repetitions, F const &func)
+{
+    double best = 0;
+
+    for (int i = 0; i < repetitions; i++)
+    {
+        auto const t0 = std::chrono::steady_clock::now();
+        func();
+        auto const t1 = std::chrono::steady_clock::now();
+
+        double const ms = std::chrono::duration<double, std::milli> (t1 - t0).count();
+        if (i == 0 || ms < best) best = ms;
+    }
+
+    return best;
+}
+
+int main (int argc, char** argv)
+{
+
+    int max_threads = (argc > 1) ? atoi (argv[1]) : (int) std::thread::hardware_concurrency();
+    int repetitions = (argc > 2) ? atoi (argv[2]) : 5;
+    if (max_threads < 1) max_threads = 1;
+    if (repetitions < 1) repetitions = 1;
+
+    Pixmap image (BENCH_W, BENCH_H, 0xFF000000, true);
+    Rectbox const full (0, 0, BENCH_W - 1, BENCH_H - 1);
+
+    double base[4] = {0, 0, 0, 0};
+
+    std::cout << "threads,fill_ms,grayscale_ms,average_filter_ms,vertical_gradient_ms,speedup_fill,speedup_grayscale,speedup_average_filter,speedup_vertical_gradient" << std::endl;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+
+        ThreadPool pool (threads);
+        image.set_executor (&pool);
+
+        double ms[4];
+        ms[0] = best_time_ms (repetitions, [&] { image.fill (0xFF204080); });
+        ms[1] = best_time_ms (repetitions, [&] { image.grayscale (); });
+        ms[2] = best_time_ms (repetitions, [&] { image.average_filter (6); });
+        ms[3] = best_time_ms (repetitions, [&] { image.vertical_gradient (full, 0xFF000000, 0x80FFFFFF); });
+
+        if (threads == 1) for (int i = 0; i < 4; i++) base[i] = ms[i];
+
+        std::cout << threads;
+        for (int i = 0; i < 4; i++) std::cout << "," << ms[i];
+        for (int i = 0; i < 4; i++) std::cout << "," << base[i] / ms[i];
+        std::cout << std::endl;
+
+        image.set_executor (nullptr);
+
+        if (threads < max_threads && threads * 2 > max_threads) threads = max_threads / 2; // Always end on 'max_threads'
+
+    }
+
+    return 0;
+
+}
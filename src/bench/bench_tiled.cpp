@@ -0,0 +1,87 @@
+/*
+    Title: French Pixmap - tiled layout benchmark
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+    Version file: 01
+    Date: 30/07/2022
+*/
+
+/* Vertical filter and 90° rotation of a 4K image, linear Pixmap against TiledPixmap.   */
+/* The linear vertical pass is 'Pixmap::convolve' with an identity horizontal kernel,  */
+/* so both sides run the same fixed-point filter and only the layout differs.          */
+/* USAGE: ./bench_tiled [tile_log2] [repetitions]                                      */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <SDL2/SDL.h>
+
+#include "../Pixmap/Pixmap.hpp"
+#include "../Pixmap/Filter.hpp"
+#include "../Pixmap/TiledPixmap.hpp"
+
+#define BENCH_W 3840
+#define BENCH_H 2160
+#define BENCH_RADIUS 8
+
+template <typename F>
+double best_time_ms (int const repetitions, F const &func)
+{
+    double best = 0;
+
+    for (int i = 0; i < repetitions; i++)
+    {
+        auto const t0 = std::chrono::steady_clock::now();
+        func();
+        auto const t1 = std::chrono::steady_clock::now();
+
+        double const ms = std::chrono::duration<double, std::milli> (t1 - t0).count();
+        if (i == 0 || ms < best) best = ms;
+    }
+
+    return best;
+}
+
+static void linear_rotate_90 (Pixmap const &src, Pixmap &dst)
+{
+    int const w = src.get_width(), h = src.get_height();
+
+    for (int y = 0; y < w; y++)
+        for (int x = 0; x < h; x++)
+            dst.get_pixels()[y * dst.get_stride() + x] = src.get_pixels()[(h - 1 - x) * src.get_stride() + y];
+}
+
+int main (int argc, char** argv)
+{
+
+    int tile_log2   = (argc > 1) ? atoi (argv[1]) : TILE_LOG2_DEFAULT;
+    int repetitions = (argc > 2) ? atoi (argv[2]) : 3;
+    if (repetitions < 1) repetitions = 1;
+
+    Pixmap image (BENCH_W, BENCH_H, 0xFF000000, true);
+    image.vertical_gradient (Rectbox (0, 0, BENCH_W - 1, BENCH_H - 1), 0xFF0000FF, 0xFFFF8000);
+
+    Pixmap linear_out (image);
+    Pixmap scratch; // Copy of the source for the linear filter, allocated once
+    Pixmap rotated    (BENCH_H, BENCH_W, 0xFF000000, true);
+
+    TiledPixmap tiled (image, tile_log2);
+    TiledPixmap tiled_rotated;
+
+    SeparableKernel const box = SeparableKernel::box (BENCH_RADIUS);
+    SeparableKernel const identity = SeparableKernel::box (0);
+
+    double const linear_vertical = best_time_ms (repetitions, [&] { linear_out.convolve (identity, box, BORDER_CLAMP, scratch); });
+    double const tiled_vertical  = best_time_ms (repetitions, [&] { tiled.vertical_convolve (box, BORDER_CLAMP); });
+    double const linear_rotate   = best_time_ms (repetitions, [&] { linear_rotate_90 (image, rotated); });
+    double const tiled_rotate    = best_time_ms (repetitions, [&] { tiled.rotate_90 (tiled_rotated); });
+    double const tiled_load      = best_time_ms (repetitions, [&] { tiled.load (image); });
+    double const tiled_store     = best_time_ms (repetitions, [&] { tiled.store (linear_out); });
+
+    std::cout << "tile_size,linear_vertical_ms,tiled_vertical_ms,speedup_vertical,linear_rotate_ms,tiled_rotate_ms,speedup_rotate,load_ms,store_ms" << std::endl;
+    std::cout << tiled.get_tile_size() << "," << linear_vertical << "," << tiled_vertical << "," << linear_vertical / tiled_vertical << ","
+              << linear_rotate << "," << tiled_rotate << "," << linear_rotate / tiled_rotate << "," << tiled_load << "," << tiled_store << std::endl;
+
+    return 0;
+
+}
@@ -0,0 +1,171 @@
+/*
+    Title: French Pixmap - headless frame benchmark
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+    Version file: 01
+    Date: 30/07/2022
+*/
+
+/* Runs the wave demo pipeline without any window and prints per-stage timings as JSON.        */
+/* USAGE: ./bench_wave [--frames N] [--size WxH]... [--threads T] [--radius R]                */
+/* Default: 200 frames at 864x486 and 3840x2160, single thread, blur radius 6.                */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+
+#include "../Pixmap/Pixmap.hpp"
+#include "../Pixmap/ThreadPool.hpp"
+#include "../Scene/Scene.hpp"
+
+#define STAGE_COUNT 5
+
+static const char* const stage_names[STAGE_COUNT] = {
+    "vertical_gradient", "blit_sin", "average_filter", "grayscale", "draw_rectbox"
+};
+
+struct StageStats {
+    double min_ms;
+    double median_ms;
+    double p99_ms;
+    double mpixels_per_s; // Pixels written by the stage, at the median time
+};
+
+static StageStats compute_stats (std::vector<double> &samples, double const pixels)
+{
+    std::sort (samples.begin(), samples.end());
+
+    size_t const n = samples.size();
+    size_t p99 = (size_t) (n * 0.99);
+    if (p99 >= n) p99 = n - 1;
+
+    StageStats stats;
+    stats.min_ms    = samples[0];
+    stats.median_ms = (n % 2) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    stats.p99_ms    = samples[p99];
+    stats.mpixels_per_s = (stats.median_ms > 0) ? pixels / (stats.median_ms * 1000.0) : 0;
+
+    return stats;
+}
+
+static void run_size (int const width, int const height, int const frames, int const radius, ThreadPool* const pool, bool const last)
+{
+
+    Pixmap render (width, height, 0xFF000000, true);
+    render.set_executor (pool);
+
+    // Same proportions as the interactive demo (320x240 flag in a 864x486 window)
+    int const image_w = std::max (3, width  * 320 / 864);
+    int const image_h = std::max (1, height * 240 / 486);
+    int const amplitude = width * 50 / 864;
+
+    Pixmap image (image_w, image_h, 0xFFFFFFFF, false);
+    image.set_executor (pool);
+    draw_french_flag (image);
+
+    int const image_x1 = (width  - image_w) / 2;
+    int const image_y1 = (height - image_h) / 2;
+
+    Rectbox const full (0, 0, width - 1, height - 1);
+    Rectbox const panel (width / 32, height / 32, width / 4, height / 6); // Translucent HUD panel
+
+    Pixmap scratch; // Reused by the blur, like a real per-frame pipeline would
+    std::vector<double> samples[STAGE_COUNT];
+
+    for (int f = 0; f < frames; f++)
+    {
+
+        std::chrono::steady_clock::time_point t[STAGE_COUNT + 1];
+
+        t[0] = std::chrono::steady_clock::now();
+        render.vertical_gradient (full, 0xFF000000, 0xFFFFFFFF);
+        t[1] = std::chrono::steady_clock::now();
+        blit_sin (image, render, image_x1, image_y1, amplitude, f * -0.05f, 0.01f);
+        t[2] = std::chrono::steady_clock::now();
+        render.average_filter (radius, scratch);
+        t[3] = std::chrono::steady_clock::now();
+        render.grayscale ();
+        t[4] = std::chrono::steady_clock::now();
+        render.draw_rectbox (panel, 0x80000000);
+        t[5] = std::chrono::steady_clock::now();
+
+        for (int s = 0; s < STAGE_COUNT; s++)
+            samples[s].push_back (std::chrono::duration<double, std::milli> (t[s + 1] - t[s]).count());
+
+    }
+
+    double const frame_pixels = (double) width * height;
+    double const stage_pixels[STAGE_COUNT] = {
+        frame_pixels, (double) image_w * image_h, frame_pixels, frame_pixels,
+        (double) (panel.x2 - panel.x1 + 1) * (panel.y2 - panel.y1 + 1)
+    };
+
+    std::cout << "    {\"width\": " << width << ", \"height\": " << height << ", \"stages\": [" << std::endl;
+
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        StageStats const st = compute_stats (samples[s], stage_pixels[s]);
+
+        std::cout << "      {\"name\": \"" << stage_names[s] << "\""
+                  << ", \"min_ms\": " << st.min_ms
+                  << ", \"median_ms\": " << st.median_ms
+                  << ", \"p99_ms\": " << st.p99_ms
+                  << ", \"mpixels_per_s\": " << st.mpixels_per_s
+                  << "}" << (s + 1 < STAGE_COUNT ? "," : "") << std::endl;
+    }
+
+    std::cout << "    ]}" << (last ? "" : ",") << std::endl;
+
+}
+
+int main (int argc, char** argv)
+{
+
+    int frames  = 200;
+    int threads = 1;
+    int radius  = 6;
+    std::vector<std::pair<int, int>> sizes;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool const has_value = i + 1 < argc;
+
+        if      (!strcmp (argv[i], "--frames")  && has_value) frames  = atoi (argv[++i]);
+        else if (!strcmp (argv[i], "--threads") && has_value) threads = atoi (argv[++i]);
+        else if (!strcmp (argv[i], "--radius")  && has_value) radius  = atoi (argv[++i]);
+        else if (!strcmp (argv[i], "--size")    && has_value)
+        {
+            int w = 0, h = 0;
+            if (sscanf (argv[++i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) sizes.push_back ({w, h});
+            else { std::cerr << "ERROR: invalid size '" << argv[i] << "' (expected WxH)" << std::endl; return 1; }
+        }
+        else { std::cerr << "ERROR: unknown argument '" << argv[i] << "'" << std::endl; return 1; }
+    }
+
+    if (frames < 1) frames = 1;
+    if (threads < 1) threads = 1;
+    if (sizes.empty()) sizes = {{864, 486}, {3840, 2160}};
+
+    ThreadPool* pool = (threads > 1) ? new ThreadPool (threads) : nullptr;
+
+    std::cout.precision (6);
+    std::cout << "{" << std::endl;
+    std::cout << "  \"benchmark\": \"wave\", \"frames\": " << frames << ", \"threads\": " << threads << ", \"radius\": " << radius << "," << std::endl;
+    std::cout << "  \"results\": [" << std::endl;
+
+    for (size_t i = 0; i < sizes.size(); i++)
+        run_size (sizes[i].first, sizes[i].second, frames, radius, pool, i + 1 == sizes.size());
+
+    std::cout << "  ]" << std::endl << "}" << std::endl;
+
+    delete pool;
+
+    return 0;
+
+}
@@ -7,148 +7,144 @@
 */
 
 #include <iostream>
+#include <atomic>
 #include <string>
+#include <vector>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
 #include "Pixmap/Pixmap.hpp"
+#include "Pixmap/Profile.hpp"
+#include "Pixmap/StreamingTexture.hpp"
+#include "Scene/FrameScheduler.hpp"
+#include "Scene/Scene.hpp"
+#include "TextRenderer/TextRenderer.hpp"
 
 #define WIN_W 864
 #define WIN_H 486
+#define TARGET_FPS 60
 
-void blit_sin (Pixmap const &src, Pixmap &target, int const target_x1, int const target_y1, int const amplitude_x, float const phase, float const ripple_rate)
-{
-
-   /* amplitude_x: ripple distance   */
-   /* phase: ripple speed/frequency  */
-   /* ripple_rate: ripple count/rate */
-
-    int const src_height = src.get_height();
-
-    for (int y = 0; y < src_height; y++)
-    {
-        int x = target_x1 - amplitude_x * sin (y * ripple_rate + phase);
-        src.blit_line (target, y, x, target_y1 + y);
-    }
-
-}
+#ifdef __linux__
+  #define FONT_PATH "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+#elif _WIN32
+  #define FONT_PATH "C:\\Windows\\Fonts\\DejaVuSans.ttf"
+#endif
 
-void draw_french_flag (Pixmap &pix)
+int main (int argc, char** argv)
 {
-    int const third_of_the_flag = pix.get_width() / 3;
-    int const pix_height = pix.get_height() - 1;
 
-    for (int i = 0; i < 3; i++)
-    {
+    /* SDL window initialization */
 
-        Rectbox rect (third_of_the_flag * i, 0, third_of_the_flag * (i+1), pix_height);
+    if (SDL_Init (SDL_INIT_VIDEO) < 0) { std::cerr << "ERROR: " << SDL_GetError() << std::endl; return 1; };
+    if (TTF_Init() < 0) { std::cerr << "ERROR: " << TTF_GetError() << std::endl; return 1; }
 
-        pixel colour;
-        if      (i == 0) colour = 0xFF0050A4;
-        else if (i == 1) colour = 0xFFFFFFFF;
-        else    {        colour = 0xFFEF4135; rect.x2 += 1;}
+    SDL_Window* win = SDL_CreateWindow ("French Pixmap", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIN_W, WIN_H, 0);
+    if (!win) { std::cerr << "ERROR: Failed to create SDL window. " << SDL_GetError() << std::endl; return 1; }
 
-        pix.draw_rectbox (rect, colour);
+    /* Headless runs (SDL_VIDEODRIVER=dummy, e.g. in CI) only have the software renderer */
 
-    }
-}
+    const char* video_driver = SDL_GetCurrentVideoDriver();
+    bool const headless = video_driver && std::string (video_driver) == "dummy";
 
-void draw_checkerboard (Pixmap &pix, int const side_length)
-{
-    int const pix_width  = pix.get_width()  / side_length;
-    int const pix_height = pix.get_height() / side_length;
+    SDL_Renderer* ren = SDL_CreateRenderer (win, -1, headless ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
+    if (!ren) { std::cerr << "ERROR: Failed to create SDL renderer. " << SDL_GetError() << std::endl; return 1; }
 
-    for (int y = 0; y < pix_height; y++)
-    {
-        for (int x = 0; x < pix_width; x++)
-        {
+    /* Presentation: damaged rects uploaded into a static texture, or with "stream" as 4th argument,
+       every frame drawn whole straight into the locked memory of a streaming texture (no upload) */
 
-            pixel colour;
-            if (x % 2 == y % 2) colour = 0xFFFFFFFF;
-            else                colour = 0xFF000000;
+    bool const streaming = argc > 4 && std::string (argv[4]) == "stream";
 
-            int x1 = x * side_length; int y1 = y * side_length;
-            Rectbox rect (x1, y1, x1 + side_length - 1, y1 + side_length - 1);
+    SDL_Texture* tex = nullptr;
+    StreamingTexture* stream = nullptr;
 
-            pix.draw_rectbox (rect, colour);
+    if (streaming) stream = new StreamingTexture (ren, WIN_W, WIN_H, FRAME_BUFFERS);
+    else           tex = SDL_CreateTexture (ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, WIN_W, WIN_H);
 
-        }
-    }
-}
-
-void draw_text (SDL_Renderer* renderer, const char* text,
-               int const size, int const x, int const y, int const w, int const h,
-               uint8_t const r, uint8_t const g, uint8_t const b, uint8_t const a)
-{
+    if (streaming ? !stream -> is_valid() : !tex) { std::cerr << "ERROR: Failed to create SDL texture. " << SDL_GetError() << std::endl; return 1; }
 
-    #ifdef __linux__
-      const char* font_path = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
-    #elif _WIN32
-      const char* font_path = "C:\\Windows\\Fonts\\DejaVuSans.ttf";
-    #endif
-
-    TTF_Font* font = TTF_OpenFont (font_path, size);
+    // Keeps the font open and the label textures between frames, destroyed before the renderer
+    TextRenderer* text = new TextRenderer (ren);
 
-    if (!font) { std::cerr << "ERROR: " << TTF_GetError() << std::endl; return; }
+    SDL_Event event;
 
-    const SDL_Color text_color    = {r, g, b, a};
-    const SDL_Rect  text_location = {x, y, w, h};
+    /* Program initialization */
 
-    SDL_Surface* text_surface = TTF_RenderText_Blended (font, text, text_color);
-    SDL_Texture* text_texture = SDL_CreateTextureFromSurface (renderer, text_surface);
-    if (a!=255) SDL_SetTextureAlphaMod(text_texture, a); // Apply the alpha channel if necessary
+    #ifdef PIXMAP_PROFILE
+        profile_set_tracing (true); // Every call of the run ends up in 'pixmap_trace.json'
+    #endif
 
-    SDL_RenderCopy (renderer, text_texture, NULL, &text_location); // Render the created texture
+    Pixmap background (WIN_W, WIN_H, 0xFF000000, false);  // Static layer, drawn once
+    Pixmap image      (320,   240,   0xFFFFFFFF, false);  // Pixmap that will be animated
 
-    /* Destruction of work datas */
+    //draw_checkerboard (image, 40) // Instead of 'draw_french_flag' if you wish it.
+    draw_french_flag (image); // Draw the pixmap as a parameter
+    image.average_filter (6); // Average filter, adds blur effect
 
-    SDL_DestroyTexture (text_texture);
-    SDL_FreeSurface (text_surface);
-    TTF_CloseFont (font);
+    Rectbox render_rect (0, 0, WIN_W-1, WIN_H-1); // For gradient of background
 
-}
+    //background.fill (0xFF000000); // for black background, instead of 'vertical_gradient' if you wish it
+    background.vertical_gradient (render_rect, 0xFF000000, 0xFFFFFFFF);
 
-int main (int argc, char** argv)
-{
+    Pixmap render (background); // Render Pixmap (image is blitted in), one copy per frame buffer of the scheduler
+    render.set_damage_tracking (true); // Only the damaged rects are restored and uploaded each frame
 
-    /* SDL window initialization */
+    WaveWarp wave; // Sine table of the flag animation
 
-    if (SDL_Init (SDL_INIT_VIDEO) < 0) { std::cerr << "ERROR: " << SDL_GetError() << std::endl; return 1; };
-    if (TTF_Init() < 0) { std::cerr << "ERROR: " << TTF_GetError() << std::endl; return 1; }
+    int const image_x1 = (WIN_W - image.get_width())  / 2;
+    int const image_y1 = (WIN_H - image.get_height()) / 2;
 
-    SDL_Window* win = SDL_CreateWindow ("French Pixmap", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIN_W, WIN_H, 0);
-    if (!win) { std::cerr << "ERROR: Failed to create SDL window. " << SDL_GetError() << std::endl; return 1; }
+    // Changed by the keys on this thread, read by the rasterizing thread
+    std::atomic<float> phase_factor, ripple_rate;
+    if (argc > 1) phase_factor = -atoi(argv[1]) * 0.001;
+    else          phase_factor = -0.05;
+    if (argc > 2) ripple_rate = atoi(argv[2]) * 0.001;
+    else          ripple_rate  =  0.01;
 
-    SDL_Renderer* ren = SDL_CreateRenderer (win, -1, SDL_RENDERER_ACCELERATED);
-    SDL_Texture*  tex = SDL_CreateTexture (ren, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, WIN_W, WIN_H);
+    int const max_frames = (argc > 3) ? atoi(argv[3]) : 0; // Stops after this many frames (0: until the window is closed)
 
-    SDL_Event event;
+    /* Rasterization of a frame (worker thread of the scheduler) */
 
-    /* Program initialization */
+    Rectbox flag_area[FRAME_BUFFERS]; // Area covered by the flag in the previous frame of each buffer (empty at first)
+    Rectbox last_flag_area;           // Area covered by the flag in the previous frame, whatever its buffer
 
-    Pixmap render (WIN_W, WIN_H, 0xFF000000, false);  // Render Pixmap (image is blitted in)
-    Pixmap image  (320,   240,   0xFFFFFFFF, false);  // Pixmap that will be animated
+    auto const rasterize = [&] (Pixmap &frame, int const buffer, unsigned long const index) // Each buffer starts fully damaged
+    {
+        if (streaming)
+        {
+            // The locked memory is undefined: the background is drawn again rather than copied
+            frame.vertical_gradient (render_rect, 0xFF000000, 0xFFFFFFFF);
+        }
+        else
+        {
+            // Erases the flag this buffer still holds, and re-marks the one of the previous frame, which
+            // is on the texture but was never drawn in this buffer: both have to be uploaded again
+            frame.restore (background, flag_area[buffer]);
+            frame.restore (background, last_flag_area);
+        }
 
-    //draw_checkerboard (image, 40) // Instead of 'draw_french_flag' if you wish it.
-    draw_french_flag (image); // Draw the pixmap as a parameter
-    image.average_filter (6); // Average filter, adds blur effect
+        flag_area[buffer] = wave.blit (image, frame, image_x1, image_y1, 50, (index * phase_factor), ripple_rate, true);
+        last_flag_area = flag_area[buffer];
+    };
 
-    int render_w = render.get_width(), render_h = render.get_height();
-    Rectbox render_rect (0, 0, render_w-1, render_h-1); // For gradient of background
+    // Headless runs are not paced: they measure how fast frames can be produced
+    FrameScheduler* scheduler = nullptr;
 
-    int const image_x1 = (render.get_width()  - image.get_width())  / 2;
-    int const image_y1 = (render.get_height() - image.get_height()) / 2;
+    if (streaming)
+    {
+        // The buffers of the scheduler are the locked textures themselves
+        std::vector<Pixmap> buffers (FRAME_BUFFERS);
 
-    int tex_w, tex_h; // Query on texture for get its dimension on 'tex_w && tex_h'
-    SDL_QueryTexture (tex, NULL, NULL, &tex_w, &tex_h);
+        for (int b = 0; b < FRAME_BUFFERS; b++)
+            if (!stream -> lock (b, buffers[b])) { std::cerr << "ERROR: Failed to lock SDL texture. " << SDL_GetError() << std::endl; return 1; }
 
-    float phase_factor, ripple_rate;
-    if (argc > 1) phase_factor = -atoi(argv[1]) * 0.001;
-    else          phase_factor = -0.05;
-    if (argc > 2) ripple_rate = atoi(argv[2]) * 0.001;
-    else          ripple_rate  =  0.01;
+        scheduler = new FrameScheduler (std::move (buffers), rasterize, headless ? 0 : TARGET_FPS);
+    }
+    else
+    {
+        scheduler = new FrameScheduler (render, rasterize, headless ? 0 : TARGET_FPS);
+    }
 
-    int  loop_nb = 0;   // Number of iterations of the execution loop (is used to calculate the phase of 'blit_sin')
+    int  loop_nb = 0;   // Number of presented frames
     bool running = true;
 
     /* Program execution */
@@ -168,29 +164,38 @@ int main (int argc, char** argv)
                 switch (event.key.keysym.sym)
                 {
                     case SDLK_UP:
-                        phase_factor -= 0.001; break;
+                        phase_factor = phase_factor - 0.001; break;
                     case SDLK_DOWN:
-                        phase_factor += 0.001; break;
+                        phase_factor = phase_factor + 0.001; break;
                     case SDLK_LEFT:
-                        ripple_rate  -= 0.001; break;
+                        ripple_rate  = ripple_rate - 0.001; break;
                     case SDLK_RIGHT:
-                        ripple_rate  += 0.001; break;
+                        ripple_rate  = ripple_rate + 0.001; break;
                     default: break;
                 }
             }
 
         }
 
-        /* Animating the pixmap */
+        /* Uploading the pixmap (the next frame is rasterized meanwhile) */
 
-        //render.fill (0xFF000000); // for black background, instead of 'vertical_gradient' if you wish it
-        render.vertical_gradient (render_rect, 0xFF000000, 0xFFFFFFFF);
+        int buffer;
+        Pixmap &frame = scheduler -> acquire (&buffer);
 
-        blit_sin (image, render, image_x1, image_y1, 50, (loop_nb * phase_factor), ripple_rate);
+        if (streaming)
+        {
+            stream -> unlock (buffer); // Already in the texture: the buffer goes back to the worker once presented
+        }
+        else
+        {
+            frame.merge_damage ();
+            frame.blit_on_texture (tex, 0, 0);
+            frame.clear_damage ();
 
-        render.blit_on_texture_centered (tex, tex_w, tex_h);
+            scheduler -> release ();
+        }
 
-        SDL_RenderCopy (ren, tex, NULL, NULL);
+        SDL_RenderCopy (ren, streaming ? stream -> get_texture (buffer) : tex, NULL, NULL);
 
         /* Calculation and display of an understandable speed */
 
@@ -198,8 +203,8 @@ int main (int argc, char** argv)
         const std::string speed_info_str = "SPEED: " + std::to_string (speed_info_val);
         const char* speed_info_txt = speed_info_str.c_str();
 
-        draw_text (ren, speed_info_txt, 32, 25, 25, 175, 75, 255, 255, 255, 255);
-        draw_text (ren, "UP / DOWN", 32, 25, (WIN_H - 90), 175, 75, 0, 0, 0, 255);
+        text->draw (FONT_PATH, speed_info_txt, 32, 25, 25, 175, 75, 255, 255, 255, 255);
+        text->draw (FONT_PATH, "UP / DOWN", 32, 25, (WIN_H - 90), 175, 75, 0, 0, 0, 255);
 
         /* Calculation and display of an understandable ripple rate */
 
@@ -207,20 +212,48 @@ int main (int argc, char** argv)
         const std::string ripple_rate_info_str = "RIPPLE RATE: " + std::to_string (ripple_rate_info_val);
         const char* ripple_rate_info_txt = ripple_rate_info_str.c_str();
 
-        draw_text (ren, ripple_rate_info_txt, 32, (WIN_W - 200), 25, 175, 75, 255, 255, 255, 255);
-        draw_text (ren, "LEFT / RIGHT", 32, (WIN_W - 200), (WIN_H - 90), 175, 75, 0, 0, 0, 255);
+        text->draw (FONT_PATH, ripple_rate_info_txt, 32, (WIN_W - 200), 25, 175, 75, 255, 255, 255, 255);
+        text->draw (FONT_PATH, "LEFT / RIGHT", 32, (WIN_W - 200), (WIN_H - 90), 175, 75, 0, 0, 0, 255);
+
+        text->end_frame(); // Labels that changed this frame (key press) free their old texture
 
         /* Render/wait/increment */
 
         SDL_RenderPresent (ren);
-        SDL_Delay (16); // 17ms - 1ms = ~60fps
+
+        if (streaming)
+        {
+            // The worker draws the frame after next in the memory of the texture just presented
+            if (stream -> lock (buffer, frame)) scheduler -> release ();
+            else { std::cerr << "ERROR: Failed to lock SDL texture. " << SDL_GetError() << std::endl; running = false; }
+        }
+
+        scheduler -> frame_presented (); // Sleeps what is left of the frame period
         ++loop_nb;
 
+        if (max_frames > 0 && loop_nb >= max_frames) running = false;
+
     }
 
     /* Closing the program */
 
-    SDL_DestroyTexture  (tex);
+    FrameStats const stats = scheduler -> get_stats ();
+
+    std::cout.precision (4);
+    std::cout << "{\"frames\": " << stats.frames << ", \"fps\": " << stats.fps
+              << ", \"latency_ms\": {\"mean\": " << stats.latency_mean_ms << ", \"p99\": " << stats.latency_p99_ms << ", \"max\": " << stats.latency_max_ms << "}"
+              << ", \"interval_ms\": " << stats.interval_mean_ms << ", \"jitter_ms\": " << stats.jitter_ms << "}" << std::endl;
+
+    #ifdef PIXMAP_PROFILE
+        profile_write_json ("pixmap_profile.json");
+        profile_write_chrome_trace ("pixmap_trace.json");
+    #endif
+
+    delete scheduler; // Before the textures its buffers may wrap
+    delete text;
+    delete stream;
+
+    if (tex) SDL_DestroyTexture (tex);
     SDL_DestroyRenderer (ren);
     SDL_DestroyWindow   (win);
 
@@ -0,0 +1,92 @@
+/*
+    Title: French Pixmap - PixmapView tests
+    Author: Le Juez Victor
+    Thanks to: Jacques-Olivier Lapeyre
+    Version file: 01
+    Date: 30/07/2022
+*/
+
+/* One tile per std::thread on a parent that has an executor: every tile must end up */
+/* filled with its own colour. Prints each failing case, exits non-zero on failure.  */
+/* USAGE: ./test_pixmap_view                                                          */
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <SDL2/SDL.h>
+
+#include "../Pixmap/Pixmap.hpp"
+#include "../Pixmap/PixmapView.hpp"
+#include "../Pixmap/ThreadPool.hpp"
+
+#define TEST_TIMEOUT_S 30 // The regression this catches used to hang rather than fail
+
+// 2048² parent on a 4-thread pool, 512² tiles each filled from its own thread: returns the wrong pixels
+static long long tile_per_thread_errors (bool const views_on_pool)
+{
+    ThreadPool pool (4);
+
+    Pixmap parent (2048, 2048, 0xFF000000, false);
+    parent.set_executor (&pool);
+
+    std::vector<PixmapView> tiles = split_tiles (parent, 512, 512);
+    std::vector<std::thread> threads;
+
+    if (views_on_pool) for (PixmapView &tile : tiles) tile.set_executor (&pool); // Several threads share the pool
+
+    std::atomic<int> finished (0);
+
+    for (size_t i = 0; i < tiles.size(); i++)
+        threads.emplace_back ([&tiles, &finished, i] { tiles[i].fill (0xFF000000 | (pixel) (i + 1)); finished++; });
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds (TEST_TIMEOUT_S);
+
+    while (finished < (int) tiles.size())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            std::cout << "FAIL: tile per thread (views " << (views_on_pool ? "on" : "without") << " the pool): hung." << std::endl;
+            std::_Exit (1); // The threads cannot be joined
+        }
+
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+
+    for (std::thread &t : threads) t.join();
+
+    long long errors = 0;
+
+    for (size_t i = 0; i < tiles.size(); i++)
+        for (int y = 0; y < tiles[i].get_height(); y++)
+            for (int x = 0; x < tiles[i].get_width(); x++)
+                if (parent.read_pixel (tiles[i].get_x() + x, tiles[i].get_y() + y) != (0xFF000000 | (pixel) (i + 1))) errors++;
+
+    return errors;
+}
+
+int main ()
+{
+
+    int failures = 0;
+
+    for (int run = 0; run < 5; run++) // The scheduling changes from one run to the next
+    {
+        for (bool const views_on_pool : {false, true})
+        {
+            long long const errors = tile_per_thread_errors (views_on_pool);
+            if (errors == 0) continue;
+
+            std::cout << "FAIL: tile per thread (views " << (views_on_pool ? "on" : "without") << " the pool, run " << run << "): "
+                      << errors << " wrong pixels." << std::endl;
+            failures++;
+        }
+    }
+
+    if (failures == 0) std::cout << "test_pixmap_view: OK" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+
+}